@@ -24,16 +24,35 @@ void CuRefreshRateTuner::Run(const std::string &configPath)
 
 void CuRefreshRateTuner::Init_(const std::string &configPath)
 {
+	auto config = LoadStartupConfig_(configPath);
+	auto screenStateSource = std::string("auto");
+	if (config.contains("screenStateSource")) {
+		screenStateSource = config.at("screenStateSource").toString();
+	}
+	if (config.contains("threadPool")) {
+		auto threadPool = config.at("threadPool").toObject();
+		size_t size = 2;
+		std::vector<int> cpus{};
+		if (threadPool.contains("size")) {
+			size = std::max(threadPool.at("size").toInt(), 1);
+		}
+		if (threadPool.contains("cpus")) {
+			cpus = threadPool.at("cpus").toArray().toListInt();
+		}
+		ThreadPool::Configure(size, cpus);
+	}
+
 	modules_.emplace_back(new RefreshRateTuner(configPath));
 	modules_.emplace_back(new InputListener());
-	modules_.emplace_back(new CgroupWatcher());
+	modules_.emplace_back(new CgroupWatcher(screenStateSource));
 	modules_.emplace_back(new TopAppMonitor());
+	modules_.emplace_back(new ProcEventListener());
 	for (const auto &module : modules_) {
 		module->Start();
 	}
 
 	{
-		auto proc = CU::Format("{}\n", getpid());
+		auto proc = CU::Format(CU_FMT("{}\n"), getpid());
 		CU::WriteFile("/dev/cpuset/system-background/cgroup.procs", proc);
 		CU::WriteFile("/dev/cpuctl/cgroup.procs", proc);
 		CU::WriteFile("/dev/stune/cgroup.procs", proc);
@@ -42,3 +61,14 @@ void CuRefreshRateTuner::Init_(const std::string &configPath)
 	CU::Logger::Info("Daemon Running (pid={}).", getpid());
 	CU::EventTransfer::Post("Main.InitFinished", 0);
 }
+
+CU::JSONObject CuRefreshRateTuner::LoadStartupConfig_(const std::string &configPath)
+{
+	// Startup-only options, changing them needs a daemon restart.
+	try {
+		return CU::JSONObject(CU::ReadFile(configPath), true);
+	} catch (const std::exception &e) {
+		CU::Logger::Warn("Failed to load startup options, using defaults.");
+	}
+	return {};
+}
@@ -7,9 +7,12 @@
 #include "modules/topapp_monitor.h"
 #include "modules/input_listener.h"
 #include "modules/refresh_rate_tuner.h"
+#include "modules/proc_event_listener.h"
 #include "utils/libcu.h"
 #include "utils/CuLogger.h"
 #include "utils/CuEventTransfer.h"
+#include "utils/CuJSONObject.h"
+#include "utils/CuFile.h"
 
 class CuRefreshRateTuner
 {
@@ -22,4 +25,5 @@ class CuRefreshRateTuner
 		std::vector<Module*> modules_;
 
 		void Init_(const std::string &configPath);
+		CU::JSONObject LoadStartupConfig_(const std::string &configPath);
 };
@@ -1,5 +1,6 @@
 #include "CuRefreshRateTuner.h"
 #include "utils/CuLogger.h"
+#include "utils/CuFlightRecorder.h"
 #include "utils/libcu.h"
 
 constexpr char DAEMON_NAME[] = "CuRefreshRateTuner";
@@ -22,21 +23,32 @@ std::vector<std::string> ParseArgs(int argc, char* argv[])
 void KillOldDaemon(void)
 {
 	int daemon_pid = getpid();
-	auto procs = CU::ListFile("/proc", DT_DIR);
-	for (const auto &proc : procs) {
-		int pid = CU::StrToInt(proc);
-		if (pid > 0 && pid <= INT16_MAX) {
-			if (pid != daemon_pid && CU::ReadFile(CU::Format("/proc/{}/cmdline", pid)) == DAEMON_NAME) {
-				kill(pid, SIGKILL);
+	CU::DirReader procs("/proc", DT_DIR);
+	char cmdlinePath[32] = { 0 };
+	while (procs.next()) {
+		auto pid = procs.number();
+		if (pid > 0 && pid <= INT16_MAX && pid != daemon_pid) {
+			// argv[0] and the NUL after it are enough to tell ours apart.
+			CU::FormatTo(cmdlinePath, CU_FMT("/proc/{}/cmdline"), pid);
+			int fd = open(cmdlinePath, (O_RDONLY | O_CLOEXEC));
+			if (fd < 0) {
+				continue;
 			}
-		} 
+			char cmdline[sizeof(DAEMON_NAME)] = { 0 };
+			auto len = read(fd, cmdline, sizeof(cmdline));
+			close(fd);
+			if (len >= static_cast<ssize_t>(sizeof(DAEMON_NAME) - 1) && std::memcmp(cmdline, DAEMON_NAME, sizeof(cmdline)) == 0) {
+				kill(static_cast<pid_t>(pid), SIGKILL);
+			}
+		}
 	}
 }
 
 std::string GetTaskTombstonePath(int pid) 
 {
 	auto tombstonePaths = CU::ListPath("/data/tombstones");
-	auto tombstoneSymbol = CU::Format("pid: {}", pid);
+	char tombstoneSymbol[32] = { 0 };
+	CU::FormatTo(tombstoneSymbol, CU_FMT("pid: {}"), pid);
 	for (const auto &tombstonePath : tombstonePaths) {
 		if (CU::StrContains(CU::ReadFile(tombstonePath), tombstoneSymbol)) {
 			return tombstonePath;
@@ -45,6 +57,16 @@ std::string GetTaskTombstonePath(int pid)
 	return {};
 }
 
+// The recorder lives next to the log, rotation never touches it.
+std::string GetFlightRecorderPath(const std::string &logPath)
+{
+	auto pos = logPath.rfind('/');
+	if (pos == std::string::npos) {
+		return "flight_recorder.bin";
+	}
+	return logPath.substr(0, pos + 1) + "flight_recorder.bin";
+}
+
 void StartDaemonWatchDog(const std::string &logPath)
 {
 	int daemon_pid = getpid();
@@ -54,8 +76,10 @@ void StartDaemonWatchDog(const std::string &logPath)
 		CU::SetTaskSchedPrio(0, 120);
 
 		CU::Logger::Create(CU::Logger::LogLevel::INFO, logPath);
+		char cmdlinePath[32] = { 0 };
+		CU::FormatTo(cmdlinePath, CU_FMT("/proc/{}/cmdline"), daemon_pid);
 		for (;;) {
-			if (CU::ReadFile(CU::Format("/proc/{}/cmdline", daemon_pid)) != DAEMON_NAME) {
+			if (CU::ReadFile(cmdlinePath) != DAEMON_NAME) {
 				CU::Logger::Info("Daemon stop running.");
 				auto tombstonePath = GetTaskTombstonePath(daemon_pid);
 				if (CU::IsPathExists(tombstonePath)) {
@@ -63,6 +87,8 @@ void StartDaemonWatchDog(const std::string &logPath)
 					CU::Logger::Error("Tombstone path: {}.", tombstonePath);
 					CU::Logger::Error("-- tombstone start --\n{}", CU::ReadFile(tombstonePath));
 					CU::Logger::Error("-- tombstone end --");
+					CU::Logger::Error("-- flight recorder start --\n{}", CU::FlightRecorder::Decode(GetFlightRecorderPath(logPath)));
+					CU::Logger::Error("-- flight recorder end --");
 					CU::Logger::Flush();
 				}
 				break;
@@ -88,11 +114,18 @@ int main(int argc, char* argv[])
 	CU::SetThreadName(DAEMON_NAME);
 	CU::SetTaskSchedPrio(0, 120);
 
+	// CuRefreshRate --decode-flight [recorderPath]
+	if (args.size() == 3 && args[1] == "--decode-flight") {
+		std::fputs(CU::FlightRecorder::Decode(args[2]).c_str(), stdout);
+		return 0;
+	}
+
 	// CuRefreshRate [configPath] [logPath]
 	if (args.size() == 3) {
 		KillOldDaemon();
 		daemon(0, 0);
 		StartDaemonWatchDog(args[2]);
+		CU::FlightRecorder::Open(GetFlightRecorderPath(args[2]));
 		CU::Logger::Create(CU::Logger::LogLevel::DEBUG, args[2]);
 		CU::Logger::Info("CuRefreshRateTuner V1 ({}) by chenzyadb.", CU::CompileDateCode());
 		StartDaemon(args[1]);
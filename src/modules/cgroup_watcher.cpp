@@ -1,24 +1,81 @@
 #include "cgroup_watcher.h"
 
-CgroupWatcher::CgroupWatcher() : Module(), screenState_(ScreenState::SCREEN_ON) { }
+// A screen state change has to persist this long, a stray task migration cannot flap the refresh rate.
+constexpr time_t SCREEN_STATE_DEBOUNCE_MS = 200;
+constexpr time_t SCREEN_STATE_DEBOUNCE_SLACK_MS = 50;
+// Polled sources only need to be roughly periodic, let the timer share wakeups.
+constexpr time_t SCREEN_STATE_POLL_SLACK_MS = 100;
+
+CgroupWatcher::CgroupWatcher(const std::string &screenStateSource) : 
+	Module(), 
+	screenStateSource_(CreateScreenStateSource(screenStateSource)), 
+	screenState_(ScreenState::SCREEN_ON), 
+	debouncing_(false), 
+	watchedCgroups_(), 
+	mtx_(), 
+	pollTimer_() 
+{
+	// Subscribed before any module starts, consumers declare the cgroups they need from their Start().
+	CU::EventTransfer::Subscribe("CgroupWatcher.WatchCgroup", this,
+		std::bind(&CgroupWatcher::WatchCgroupRequested_, this, std::placeholders::_1));
+}
 
 CgroupWatcher::~CgroupWatcher() { }
 
 void CgroupWatcher::Start()
 {
-	auto cpusetPaths = CU::ListPath("/dev/cpuset", DT_DIR);
-	for (const auto &cpusetPath : cpusetPaths) {
-		auto tasksPath = cpusetPath + "/tasks";
+	for (const auto &cgroup : screenStateSource_->Cgroups()) {
+		WatchCgroup_(cgroup);
+	}
+	ScreenState screenState{};
+	{
+		std::unique_lock<std::mutex> lck(mtx_);
+		screenState_ = screenStateSource_->Read();
+		screenState = screenState_;
+	}
+	CU::EventTransfer::Post("CgroupWatcher.ScreenStateChanged", screenState);
+	auto pollInterval = screenStateSource_->PollIntervalMs();
+	if (pollInterval > 0) {
+		pollTimer_.setTimeOutCallback(std::bind(&CgroupWatcher::CheckScreenState_, this));
+		pollTimer_.setInterval(pollInterval);
+		pollTimer_.setSlack(SCREEN_STATE_POLL_SLACK_MS);
+		pollTimer_.start();
+	}
+}
+
+void CgroupWatcher::WatchCgroup_(const std::string &cgroup)
+{
+	{
+		std::unique_lock<std::mutex> lck(mtx_);
+		if (!watchedCgroups_.emplace(cgroup).second) {
+			return;
+		}
+	}
+	auto cgroupPath = "/dev/cpuset/" + cgroup;
+	if (!CU::IsPathExists(cgroupPath)) {
+		cgroupPath = "/sys/fs/cgroup/" + cgroup;
+	}
+	// cgroup.events only changes on populated transitions, migrations still show up on cgroup.procs.
+	auto eventsPath = cgroupPath + "/cgroup.events";
+	if (CU::IsPathExists(eventsPath)) {
+		FileWatcher_AddWatch(eventsPath, std::bind(&CgroupWatcher::CgroupModified_, this));
+	} else {
+		auto tasksPath = cgroupPath + "/tasks";
 		if (CU::IsPathExists(tasksPath)) {
 			FileWatcher_AddWatch(tasksPath, std::bind(&CgroupWatcher::CgroupModified_, this));
 		}
-		auto procsPath = cpusetPath + "/cgroup.procs";
-		if (CU::IsPathExists(procsPath)) {
-			FileWatcher_AddWatch(procsPath, std::bind(&CgroupWatcher::CgroupModified_, this));
-		}
 	}
-	screenState_ = GetScreenState();
-	CU::EventTransfer::Post("CgroupWatcher.ScreenStateChanged", screenState_);
+	auto procsPath = cgroupPath + "/cgroup.procs";
+	if (CU::IsPathExists(procsPath)) {
+		FileWatcher_AddWatch(procsPath, std::bind(&CgroupWatcher::CgroupModified_, this));
+	} else {
+		CU::Logger::Warn("Cgroup \"{}\" not found.", cgroup);
+	}
+}
+
+void CgroupWatcher::WatchCgroupRequested_(const CU::EventTransfer::TransData &transData)
+{
+	WatchCgroup_(CU::EventTransfer::GetData<std::string>(transData));
 }
 
 void CgroupWatcher::CgroupModified_()
@@ -29,9 +86,26 @@ void CgroupWatcher::CgroupModified_()
 
 void CgroupWatcher::CheckScreenState_()
 {
-	auto nowaScreenState = GetScreenState();
-	if (screenState_ != nowaScreenState) {
-		CU::EventTransfer::Post("CgroupWatcher.ScreenStateChanged", nowaScreenState);
+	std::unique_lock<std::mutex> lck(mtx_);
+	if (!debouncing_ && screenStateSource_->Read() != screenState_) {
+		debouncing_ = true;
+		CU::Timer::SingleShot(SCREEN_STATE_DEBOUNCE_MS, std::bind(&CgroupWatcher::ConfirmScreenState_, this), 
+			SCREEN_STATE_DEBOUNCE_SLACK_MS);
+	}
+}
+
+void CgroupWatcher::ConfirmScreenState_()
+{
+	auto nowaScreenState = ScreenState::SCREEN_ON;
+	{
+		std::unique_lock<std::mutex> lck(mtx_);
+		debouncing_ = false;
+		nowaScreenState = screenStateSource_->Read();
+		if (screenState_ == nowaScreenState) {
+			return;
+		}
 		screenState_ = nowaScreenState;
 	}
+	CU::FlightRecorder::Record("screen", static_cast<int64_t>(nowaScreenState));
+	CU::EventTransfer::Post("CgroupWatcher.ScreenStateChanged", nowaScreenState);
 }
@@ -1,23 +1,37 @@
 #pragma once
 
 #include "platform/module.h"
+#include "platform/screen_state_source.h"
 #include "utils/libcu.h"
 #include "utils/CuFile.h"
 #include "utils/CuSched.h"
 #include "utils/CuLogger.h"
+#include "utils/CuFlightRecorder.h"
 #include "utils/CuEventTransfer.h"
+#include "utils/CuTimer.h"
 #include "utils/android_platform.h"
+#include <mutex>
+#include <unordered_set>
 
 class CgroupWatcher : public Module
 {
 	public:
-		CgroupWatcher();
+		CgroupWatcher(const std::string &screenStateSource);
 		~CgroupWatcher();
 		void Start();
 
 	private:
+		std::unique_ptr<ScreenStateSource> screenStateSource_;
 		ScreenState screenState_;
+		bool debouncing_;
+		std::unordered_set<std::string> watchedCgroups_;
+		std::mutex mtx_;
+		// Last member, it is stopped before anything its callback touches goes away.
+		CU::Timer pollTimer_;
 
+		void WatchCgroup_(const std::string &cgroup);
+		void WatchCgroupRequested_(const CU::EventTransfer::TransData &transData);
 		void CgroupModified_();
 		void CheckScreenState_();
+		void ConfirmScreenState_();
 };
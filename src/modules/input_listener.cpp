@@ -1,65 +1,119 @@
 #include "input_listener.h"
 
-InputListener::InputListener() : Module() { }
+InputListener::InputListener() : Module(), touching_(), epollFd_(epoll_create1(EPOLL_CLOEXEC)) { }
 
 InputListener::~InputListener() { }
 
 void InputListener::Start()
 {
+	if (epollFd_ < 0) {
+		CU::Logger::Warn("Failed to create input epoll fd.");
+		return;
+	}
 	auto eventPaths = CU::ListPath("/dev/input", DT_CHR);
 	for (const auto &eventPath : eventPaths) {
-		std::thread(std::bind(&InputListener::ListenerMain_, this, eventPath)).detach();
+		AddDevice_(eventPath);
+	}
+	// One reader for all touch devices, touch delivery must not queue behind proc events and inotify
+	// callbacks on the FileWatcher loop.
+	if (!touching_.empty()) {
+		std::thread thread_(std::bind(&InputListener::ReaderMain_, this));
+		thread_.detach();
 	}
 }
 
-void InputListener::ListenerMain_(std::string eventPath)
+void InputListener::AddDevice_(const std::string &eventPath)
 {
 	static const auto checkBit = [](const char* bit, unsigned short mask) -> bool {
 		return ((bit[mask / 8] & (1 << (mask % 8))) != 0);
 	};
 
-	CU::SetThreadName("InputListener");
-	CU::SetTaskSchedPrio(0, 95);
+	int fd = open(eventPath.c_str(), (O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+	if (fd < 0) {
+		return;
+	}
 
+	char inputBit[(ABS_MAX + 1) / 8] = { 0 };
+	ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(inputBit)), inputBit);
+	if (!(checkBit(inputBit, ABS_MT_POSITION_X) && checkBit(inputBit, ABS_MT_POSITION_Y)) &&
+		!(checkBit(inputBit, ABS_X) && checkBit(inputBit, ABS_Y))) 
 	{
-		int fd = open(eventPath.c_str(), O_RDONLY | O_NONBLOCK);
-		if (fd < 0) {
-			return;
-		}
-
-		char inputBit[(ABS_MAX + 1) / 8] = { 0 };
-		ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(inputBit)), inputBit);
-		if (!(checkBit(inputBit, ABS_MT_POSITION_X) && checkBit(inputBit, ABS_MT_POSITION_Y)) &&
-			!(checkBit(inputBit, ABS_X) && checkBit(inputBit, ABS_Y))) 
-		{
-			return;
-		}
+		close(fd);
+		return;
+	}
 
-		char inputName[32] = { 0 };
-		ioctl(fd, EVIOCGNAME(sizeof(inputName)), inputName);
-		CU::Logger::Info("Listening \"{}\".", inputName);
+	char inputName[32] = { 0 };
+	ioctl(fd, EVIOCGNAME(sizeof(inputName)), inputName);
+	CU::Logger::Info("Listening \"{}\".", inputName);
 
+	struct epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, std::addressof(event)) < 0) {
+		CU::Logger::Warn("Failed to watch input device (fd={}).", fd);
 		close(fd);
+		return;
+	}
+	touching_[fd] = false;
+}
+
+void InputListener::ReaderMain_()
+{
+	CU::SetThreadName("InputListener");
+	CU::SetTaskSchedPrio(0, 95);
+
+	struct epoll_event events[8]{};
+	while (!touching_.empty()) {
+		int nfds = epoll_wait(epollFd_, events, 8, -1);
+		if (nfds < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			CU::Logger::Warn("Failed to wait input epoll fd.");
+			break;
+		}
+		for (int idx = 0; idx < nfds; idx++) {
+			DeviceReadable_(events[idx].data.fd);
+		}
 	}
+}
 
-	bool touching = false;
-	for (int fd = open(eventPath.c_str(), O_RDONLY); fd >= 0;) {
-		struct input_event inputEvent{};
-		auto len = read(fd, std::addressof(inputEvent), sizeof(struct input_event));
-		if (len == sizeof(struct input_event)) {
+void InputListener::DeviceReadable_(int fd)
+{
+	auto &touching = touching_[fd];
+	struct input_event inputEvents[64]{};
+	for (;;) {
+		auto len = read(fd, inputEvents, sizeof(inputEvents));
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return;
+			}
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (len == 0) {
+			break;
+		}
+		size_t count = static_cast<size_t>(len) / sizeof(struct input_event);
+		for (size_t idx = 0; idx < count; idx++) {
+			const auto &inputEvent = inputEvents[idx];
 			if (inputEvent.type == EV_KEY && (inputEvent.code == BTN_TOUCH || inputEvent.code == BTN_DIGI)) {
 				if (!touching && inputEvent.value == 1) {
+					CU::FlightRecorder::Record("touch", 1);
 					CU::EventTransfer::Post("InputListener.KEY_DOWN", 0);
 					touching = true;
 				} else if (touching && inputEvent.value == 0) {
+					CU::FlightRecorder::Record("touch", 0);
 					CU::EventTransfer::Post("InputListener.KEY_UP", 0);
 					touching = false;
 				}
 			}
-		} else if (len < 0) {
-			close(fd);
-			break;
 		}
 	}
-	CU::Logger::Warn("Failed to listen {}.", eventPath);
+	touching_.erase(fd);
+	epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+	CU::Logger::Warn("Failed to listen input device (fd={}).", fd);
 }
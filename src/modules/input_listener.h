@@ -2,11 +2,15 @@
 
 #include "platform/module.h"
 #include "utils/libcu.h"
-#include "utils/CuSched.h"
 #include "utils/CuLogger.h"
+#include "utils/CuFlightRecorder.h"
 #include "utils/CuEventTransfer.h"
 #include "utils/CuFile.h"
+#include "utils/CuSched.h"
+#include <unordered_map>
+#include <thread>
 #include <linux/input.h>
+#include <sys/epoll.h>
 
 class InputListener : public Module
 {
@@ -16,5 +20,11 @@ class InputListener : public Module
 		void Start();
 
 	private:
-		void ListenerMain_(std::string eventPath);
+		// Touching state per device fd, only touched by the reader thread once it runs.
+		std::unordered_map<int, bool> touching_;
+		int epollFd_;
+
+		void AddDevice_(const std::string &eventPath);
+		void ReaderMain_();
+		void DeviceReadable_(int fd);
 };
@@ -0,0 +1,48 @@
+#include "proc_event_listener.h"
+
+ProcEventListener::ProcEventListener() : Module(), connector_() { }
+
+ProcEventListener::~ProcEventListener() { }
+
+void ProcEventListener::Start()
+{
+	if (!connector_.open(true)) {
+		CU::Logger::Warn("Proc connector is unavailable, process events disabled.");
+		return;
+	}
+	FileWatcher_AddFdWatch(connector_.fd(), std::bind(&ProcEventListener::ConnectorReadable_, this));
+}
+
+void ProcEventListener::ConnectorReadable_()
+{
+	CU::ProcEventConnector::Event event{};
+	while (connector_.wait(event)) {
+		switch (event.type) {
+			case CU::ProcEventConnector::EventType::FORK:
+				CU::EventTransfer::Post("ProcEventListener.ProcessFork", event.pid);
+				break;
+			case CU::ProcEventConnector::EventType::EXEC:
+				CU::EventTransfer::Post("ProcEventListener.ProcessExec", event.pid);
+				break;
+			case CU::ProcEventConnector::EventType::COMM:
+				CU::EventTransfer::Post("ProcEventListener.ProcessComm", event.pid);
+				break;
+			case CU::ProcEventConnector::EventType::EXIT:
+				CU::EventTransfer::Post("ProcEventListener.ProcessExit", event.pid);
+				break;
+			case CU::ProcEventConnector::EventType::OVERRUN:
+				CU::Logger::Debug("Proc connector overrun, events lost.");
+				CU::EventTransfer::Post("ProcEventListener.Overrun", 0);
+				break;
+			default:
+				break;
+		}
+	}
+	if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		return;
+	}
+	FileWatcher_RemoveFdWatch(connector_.fd());
+	connector_.close();
+	CU::Logger::Warn("Failed to read proc connector.");
+	CU::EventTransfer::Post("ProcEventListener.Overrun", 0);
+}
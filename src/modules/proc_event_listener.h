@@ -0,0 +1,20 @@
+#pragma once
+
+#include "platform/module.h"
+#include "utils/libcu.h"
+#include "utils/CuLogger.h"
+#include "utils/CuEventTransfer.h"
+#include "utils/CuProcEvent.h"
+
+class ProcEventListener : public Module
+{
+	public:
+		ProcEventListener();
+		~ProcEventListener();
+		void Start();
+
+	private:
+		CU::ProcEventConnector connector_;
+
+		void ConnectorReadable_();
+};
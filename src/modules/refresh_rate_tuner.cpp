@@ -1,16 +1,29 @@
 #include "refresh_rate_tuner.h"
 
+// A touch boost that could not start in time is stale, the next touch will boost again.
+constexpr time_t TOUCH_BOOST_DEADLINE_MS = 1000;
+// One pending switch per target, a queued idle switch never replaces a pending touch boost.
+constexpr char APPLY_ACTIVE_MODE_KEY[] = "RefreshRateTuner.ApplyActiveMode";
+constexpr char APPLY_IDLE_MODE_KEY[] = "RefreshRateTuner.ApplyIdleMode";
+// Dropping to the idle refresh rate a little late is invisible, let the timer share wakeups.
+constexpr time_t IDLE_TIMER_SLACK_MS = 50;
+// service call waits on binder, a wedged SurfaceFlinger must not hold up the worker.
+constexpr time_t SERVICE_CALL_TIMEOUT_MS = 2000;
+constexpr time_t DUMPSYS_TIMEOUT_MS = 10000;
+
 RefreshRateTuner::RefreshRateTuner(const std::string &configPath) : 
     Module(), 
     configPath_(configPath),
     timer_(),
     displayModeMap_(), 
     config_(),
+    subprocess_(),
     activeDisplayModeId_(-1),
     idleDisplayModeId_(-1),
     keyDownTime_(0),
     keyUpTime_(0),
-    active_(false) 
+    active_(false), 
+    targetActive_(false) 
 { }
 
 RefreshRateTuner::~RefreshRateTuner() { }
@@ -31,25 +44,40 @@ void RefreshRateTuner::Start()
     CU::EventTransfer::Subscribe("InputListener.KEY_UP", this,
         std::bind(&RefreshRateTuner::KeyUp_, this, std::placeholders::_1));
     FileWatcher_AddWatch(configPath_, std::bind(&RefreshRateTuner::ConfigModified_, this));
-    timer_.setLoop(std::bind(&RefreshRateTuner::IdleLoop_, this));
-    timer_.setInterval(config_.data().at("idleDelay").toInt());
+    timer_.setTimeOutCallback(std::bind(&RefreshRateTuner::IdleTimeOut_, this));
+    timer_.setInterval(config_.read()->at("idleDelay").toInt());
+    timer_.setSlack(IDLE_TIMER_SLACK_MS);
     timer_.start();
 }
 
 void RefreshRateTuner::Init_()
 {
-    auto displayInfo = CU::ExecCommand("dumpsys display");
-    if (CU::StrContains(displayInfo, "mSfDisplayModes=")) {
-        std::vector<std::string> displayModes{};
-        auto lines = CU::StrSplit(displayInfo, '\n');
-        for (const auto &line : lines) {
-            // DisplayMode{id=0,width=1080,height=2460,xDpi=397.565,yDpi=397.987,refreshRate=144.00002,...
-            auto trimedLine = CU::TrimStr(line);
-            if (CU::StrStartsWith(trimedLine, "DisplayMode{")) {
-                displayModes.emplace_back(trimedLine);
-            }
+    bool hasSfDisplayModes = false, hasSupportedModes = false;
+    std::vector<std::string> displayModes{}, supportedModes{};
+    auto result = subprocess_.run({"dumpsys", "display"}, DUMPSYS_TIMEOUT_MS, [&](const std::string &line) -> bool {
+        if (!hasSfDisplayModes && CU::StrContains(line, "mSfDisplayModes=")) {
+            hasSfDisplayModes = true;
+        }
+        if (!hasSupportedModes && CU::StrContains(line, "mSupportedModes=")) {
+            hasSupportedModes = true;
+        }
+        auto trimedLine = CU::StripStr(std::string_view(line));
+        // DisplayMode{id=0,width=1080,height=2460,xDpi=397.565,yDpi=397.987,refreshRate=144.00002,...
+        if (CU::StrStartsWith(trimedLine, "DisplayMode{")) {
+            displayModes.emplace_back(trimedLine);
         }
-        for (const auto &displayMode : displayModes) {
+        // DisplayModeRecord{mMode={id=1,width=1080,height=1920,fps=60.000004}}
+        if (CU::StrStartsWith(line, "DisplayModeRecord{mMode={")) {
+            supportedModes.emplace_back(trimedLine);
+        }
+        return true;
+    });
+    if (!result.succeeded()) {
+        CU::Logger::Warn("dumpsys display failed (exit={}, signal={}, timedOut={}).", 
+            result.exitCode, result.termSignal, result.timedOut);
+    }
+    if (hasSfDisplayModes) {
+        for (std::string_view displayMode : displayModes) {
             int id = CU::StrToInt(CU::SubPrevStr(CU::SubPostStr(displayMode, "id="), ','));
             int width = CU::StrToInt(CU::SubPrevStr(CU::SubPostStr(displayMode, "width="), ','));
             int height = CU::StrToInt(CU::SubPrevStr(CU::SubPostStr(displayMode, "height="), ','));
@@ -61,17 +89,8 @@ void RefreshRateTuner::Init_()
             displayModeMap_[refreshRate][height] = id;
             CU::Logger::Info("id={}, resolution={}x{}, refreshRate={}.", id, width, height, refreshRate);
         }
-    } else if (CU::StrContains(displayInfo, "mSupportedModes=")) {
-        std::vector<std::string> supportedModes{};
-        auto lines = CU::StrSplit(displayInfo, '\n');
-        for (const auto &line : lines) {
-            // DisplayModeRecord{mMode={id=1,width=1080,height=1920,fps=60.000004}}
-            auto trimedLine = CU::TrimStr(line);
-            if (CU::StrStartsWith(line, "DisplayModeRecord{mMode={")) {
-                supportedModes.emplace_back(trimedLine);
-            }
-        }
-        for (const auto &modeRecord : supportedModes) {
+    } else if (hasSupportedModes) {
+        for (std::string_view modeRecord : supportedModes) {
             int id = CU::StrToInt(CU::SubPrevStr(CU::SubPostStr(modeRecord, "id="), ',')) - 1;
             int width = CU::StrToInt(CU::SubPrevStr(CU::SubPostStr(modeRecord, "width="), ','));
             int height = CU::StrToInt(CU::SubPrevStr(CU::SubPostStr(modeRecord, "height="), ','));
@@ -87,31 +106,27 @@ void RefreshRateTuner::Init_()
     }
 }
 
-void RefreshRateTuner::IdleLoop_()
+void RefreshRateTuner::IdleTimeOut_()
 {
-    CU::SetThreadName("IdleLoop");
-    CU::SetTaskSchedPrio(0, 95);
-
-    TIMER_LOOP(timer_) {
-        int idleDelay = config_.data().at("idleDelay").toInt();
-        if (active_ && keyUpTime_ > keyDownTime_) {
-            auto keyUpDuration = CU::TimeStamp() - keyUpTime_;
-            if (keyUpDuration >= idleDelay) {
-                SetIdleRefreshRate_();
-                timer_.setInterval(idleDelay);
-            } else {
-                timer_.setInterval(idleDelay - keyUpDuration);
-            }
-        } else {
+    // Runs on the timer thread, the display mode switch itself is left to the worker.
+    time_t idleDelay = config_.read()->at("idleDelay").toInt();
+    if (targetActive_ && keyUpTime_ > keyDownTime_) {
+        auto keyUpDuration = CU::TimeStamp() - keyUpTime_;
+        if (keyUpDuration >= idleDelay) {
+            RequestDisplayMode_(false, WorkerThread::WorkPriority::NORMAL);
             timer_.setInterval(idleDelay);
+        } else {
+            timer_.setInterval(idleDelay - keyUpDuration);
         }
+    } else {
+        timer_.setInterval(idleDelay);
     }
 }
 
 void RefreshRateTuner::LoadConfig_()
 {
     try {
-        config_ = CU::JSONObject(CU::ReadFile(configPath_), true);
+        config_.store(CU::JSONObject(CU::ReadFile(configPath_), true));
         CU::Logger::Info("Config loaded.");
     } catch (const std::exception &e) {
         CU::Logger::Warn("Failed to load config.");
@@ -131,10 +146,10 @@ void RefreshRateTuner::UpdatePolicy_(const std::string &appName)
         return displayModeMap_.atKey(fps).atKey(resolution);
     };
 
-    auto config = config_.data();
-    auto policy = config.at("*").toObject();
-    if (config.contains(appName)) {
-        policy = config.at(appName).toObject();
+    auto config = config_.read();
+    auto policy = config->at("*").toObject();
+    if (config->contains(appName)) {
+        policy = config->at(appName).toObject();
     }
     int resolution = policy.at("resolution").toInt();
     activeDisplayModeId_ = findDisplayModeId(policy.at("active").toInt(), resolution);
@@ -143,13 +158,21 @@ void RefreshRateTuner::UpdatePolicy_(const std::string &appName)
 
 void RefreshRateTuner::SetActiveRefreshRate_()
 {
-    CU::RunCommand(CU::Format("service call SurfaceFlinger 1035 i32 {}", activeDisplayModeId_));
+    CU::FlightRecorder::Record("mode", activeDisplayModeId_);
+    char modeId[16] = { 0 };
+    CU::FormatTo(modeId, CU_FMT("{}"), activeDisplayModeId_);
+    CallSurfaceFlinger_({"1035", "i32", modeId});
+    CU::Logger::Verbose("Display mode {} applied.", activeDisplayModeId_);
     active_ = true;
 }
 
 void RefreshRateTuner::SetIdleRefreshRate_()
 {
-    CU::RunCommand(CU::Format("service call SurfaceFlinger 1035 i32 {}", idleDisplayModeId_));
+    CU::FlightRecorder::Record("mode", idleDisplayModeId_);
+    char modeId[16] = { 0 };
+    CU::FormatTo(modeId, CU_FMT("{}"), idleDisplayModeId_);
+    CallSurfaceFlinger_({"1035", "i32", modeId});
+    CU::Logger::Verbose("Display mode {} applied.", idleDisplayModeId_);
     active_ = false;
 }
 
@@ -163,47 +186,92 @@ void RefreshRateTuner::ResetRefreshRate_()
 
     static int api_level = android_get_device_api_level();
     if (api_level >= 31 && isFlymeOS()) {
-        CU::RunCommand("service call SurfaceFlinger 1037");
+        CallSurfaceFlinger_({"1037"});
     }
     if (api_level >= 30) {
-        CU::RunCommand("service call SurfaceFlinger 1036 i32 0");
+        CallSurfaceFlinger_({"1036", "i32", "0"});
     }
     if (api_level >= 29) {
-        CU::RunCommand("service call SurfaceFlinger 1035 i32 -1");
+        CallSurfaceFlinger_({"1035", "i32", "-1"});
     }
     active_ = false;
 }
 
+void RefreshRateTuner::RequestDisplayMode_(bool active, WorkerThread::WorkPriority priority, time_t deadlineMs)
+{
+    // The target flips at enqueue time, a queued task only applies its mode if it is still the target.
+    targetActive_ = active;
+    if (active) {
+        WorkerThread_AddWork([this]() {
+            if (targetActive_) {
+                SetActiveRefreshRate_();
+            }
+        }, priority, deadlineMs, APPLY_ACTIVE_MODE_KEY);
+    } else {
+        WorkerThread_AddWork([this]() {
+            if (!targetActive_) {
+                SetIdleRefreshRate_();
+            }
+        }, priority, deadlineMs, APPLY_IDLE_MODE_KEY);
+    }
+}
+
+bool RefreshRateTuner::CallSurfaceFlinger_(std::initializer_list<const char*> args)
+{
+    // Runs on the worker strand (or in Init_ before it starts), subprocess_ is never shared.
+    const char* argv[8] = {"service", "call", "SurfaceFlinger"};
+    size_t argc = 3;
+    for (const auto &arg : args) {
+        if (argc < (sizeof(argv) / sizeof(argv[0]))) {
+            argv[argc++] = arg;
+        }
+    }
+    auto result = subprocess_.run(argv, argc, SERVICE_CALL_TIMEOUT_MS);
+    if (!result.succeeded()) {
+        CU::Logger::Warn("service call SurfaceFlinger {} failed (exit={}, signal={}, timedOut={}).", 
+            argv[3], result.exitCode, result.termSignal, result.timedOut);
+        return false;
+    }
+    CU::Logger::Verbose("service call SurfaceFlinger {} took {} us.", argv[3], (result.elapsedNs / 1000));
+    return true;
+}
+
 void RefreshRateTuner::ScreenStateChanged_(const CU::EventTransfer::TransData &transData)
 {
     auto screenState = CU::EventTransfer::GetData<ScreenState>(transData);
     if (screenState == ScreenState::SCREEN_OFF) {
         UpdatePolicy_("screenOff");
         timer_.pauseTimer();
-        WorkerThread_AddWork(std::bind(&RefreshRateTuner::SetIdleRefreshRate_, this));
+        RequestDisplayMode_(false, WorkerThread::WorkPriority::LATENCY_CRITICAL);
     } else {
         static const auto resetRefreshRate = [this]() {
             ResetRefreshRate_();
-            SetActiveRefreshRate_();
+            if (targetActive_) {
+                SetActiveRefreshRate_();
+            } else {
+                SetIdleRefreshRate_();
+            }
         };
         UpdatePolicy_("*");
-        WorkerThread_AddWork(resetRefreshRate);
+        targetActive_ = true;
+        WorkerThread_AddWork(resetRefreshRate, WorkerThread::WorkPriority::NORMAL, 0, "RefreshRateTuner.ResetDisplayMode");
         timer_.continueTimer();
     }
 }
 
 void RefreshRateTuner::TopAppChanged_(const CU::EventTransfer::TransData &transData)
 {
-    int pid = CU::EventTransfer::GetData<int>(transData);
-    UpdatePolicy_(CU::ReadFile(CU::Format("/proc/{}/cmdline", pid)));
-    WorkerThread_AddWork(std::bind(&RefreshRateTuner::SetActiveRefreshRate_, this));
+    const auto &packageName = CU::EventTransfer::GetData<std::string>(transData);
+    UpdatePolicy_(packageName);
+    RequestDisplayMode_(true, WorkerThread::WorkPriority::LATENCY_CRITICAL);
 }
 
 void RefreshRateTuner::KeyDown_(const CU::EventTransfer::TransData &transData)
 {
     keyDownTime_ = CU::TimeStamp();
-    if (!active_) {
-        WorkerThread_AddWork(std::bind(&RefreshRateTuner::SetActiveRefreshRate_, this));
+    // A boost that expired in the queue left the target active without applying it, so check both.
+    if (!targetActive_ || !active_) {
+        RequestDisplayMode_(true, WorkerThread::WorkPriority::LATENCY_CRITICAL, TOUCH_BOOST_DEADLINE_MS);
     }
 }
 
@@ -214,5 +282,6 @@ void RefreshRateTuner::KeyUp_(const CU::EventTransfer::TransData &transData)
 
 void RefreshRateTuner::ConfigModified_()
 {
-    WorkerThread_AddWork(std::bind(&RefreshRateTuner::LoadConfig_, this));
+    WorkerThread_AddWork(std::bind(&RefreshRateTuner::LoadConfig_, this), 
+        WorkerThread::WorkPriority::BACKGROUND, 0, "RefreshRateTuner.LoadConfig", WorkerThread::CoalescePolicy::MOVE_TO_TAIL);
 }
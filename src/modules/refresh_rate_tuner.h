@@ -2,13 +2,16 @@
 #include "utils/libcu.h"
 #include "utils/CuSched.h"
 #include "utils/CuLogger.h"
+#include "utils/CuFlightRecorder.h"
 #include "utils/CuEventTransfer.h"
 #include "utils/CuJSONObject.h"
 #include "utils/CuSafeVal.h"
 #include "utils/CuTimer.h"
 #include "utils/CuFile.h"
+#include "utils/CuSubprocess.h"
 #include "utils/CuPairList.h"
 #include "utils/android_platform.h"
+#include <atomic>
 
 class RefreshRateTuner : public Module {
     public:
@@ -21,20 +24,25 @@ class RefreshRateTuner : public Module {
         std::string configPath_;
         CU::Timer timer_;
         CU::PairList<int, CU::PairList<int, int>> displayModeMap_;
-        CU::SafeVal<CU::JSONObject> config_;
+        CU::ReadMostlyVal<CU::JSONObject> config_;
+        CU::Subprocess subprocess_;
         int activeDisplayModeId_;
         int idleDisplayModeId_;
-        uint64_t keyDownTime_;
-        uint64_t keyUpTime_;
-        bool active_;
+        time_t keyDownTime_;
+        time_t keyUpTime_;
+        // The mode last applied and the mode last requested, requests are queued before they apply.
+        std::atomic<bool> active_;
+        std::atomic<bool> targetActive_;
 
         void Init_();
-        void IdleLoop_();
+        void IdleTimeOut_();
         void LoadConfig_();
         void UpdatePolicy_(const std::string &appName);
         void SetActiveRefreshRate_();
         void SetIdleRefreshRate_();
         void ResetRefreshRate_();
+        void RequestDisplayMode_(bool active, WorkerThread::WorkPriority priority, time_t deadlineMs = 0);
+        bool CallSurfaceFlinger_(std::initializer_list<const char*> args);
         void ScreenStateChanged_(const CU::EventTransfer::TransData &transData);
         void TopAppChanged_(const CU::EventTransfer::TransData &transData);
         void KeyDown_(const CU::EventTransfer::TransData &transData);
@@ -1,46 +1,89 @@
 #include "topapp_monitor.h"
 
-TopAppMonitor::TopAppMonitor() : Module(), monitor_(), notifier_(), topAppPid_(-1) { }
+#if !defined(__NR_pidfd_open)
+#define __NR_pidfd_open 434
+#endif
 
-TopAppMonitor::~TopAppMonitor() { }
+// The probe already trails the cgroup change by 500 ms, a bit more lets it share a timer wakeup.
+constexpr time_t TOP_APP_PROBE_SLACK_MS = 100;
+// A stuck dumpsys would stall every later probe on the probe thread.
+constexpr time_t DUMPSYS_TIMEOUT_MS = 3000;
+
+TopAppMonitor::TopAppMonitor() : 
+	Module(), 
+	monitor_(), 
+	probeThread_("TopAppProbe"), 
+	topAppPid_(-1), 
+	topAppPidFd_(-1), 
+	packageCache_(), 
+	cmdlineFiles_(), 
+	dumpsys_() 
+{ }
+
+TopAppMonitor::~TopAppMonitor()
+{
+	if (topAppPidFd_ >= 0) {
+		close(topAppPidFd_);
+	}
+}
 
 void TopAppMonitor::Start() { 
 	CU::EventTransfer::Subscribe("CgroupWatcher.CgroupModified", this,
 		std::bind(&TopAppMonitor::CgroupModified_, this, std::placeholders::_1));
-	monitor_.setLoop(std::bind(&TopAppMonitor::MonitorLoop_, this));
+	CU::EventTransfer::Post("CgroupWatcher.WatchCgroup", std::string("top-app"));
+	CU::EventTransfer::Post("CgroupWatcher.WatchCgroup", std::string("foreground"));
+	CU::EventTransfer::Subscribe("CgroupWatcher.ScreenStateChanged", this,
+		std::bind(&TopAppMonitor::ScreenStateChanged_, this, std::placeholders::_1));
+	CU::EventTransfer::Subscribe("ProcEventListener.ProcessExec", this,
+		std::bind(&TopAppMonitor::ProcessStarted_, this, std::placeholders::_1));
+	CU::EventTransfer::Subscribe("ProcEventListener.ProcessComm", this,
+		std::bind(&TopAppMonitor::ProcessStarted_, this, std::placeholders::_1));
+	CU::EventTransfer::Subscribe("ProcEventListener.ProcessExit", this,
+		std::bind(&TopAppMonitor::ProcessExit_, this, std::placeholders::_1));
+	CU::EventTransfer::Subscribe("ProcEventListener.Overrun", this,
+		std::bind(&TopAppMonitor::ProcEventOverrun_, this, std::placeholders::_1));
+	monitor_.setTimeOutCallback(std::bind(&TopAppMonitor::MonitorTimeOut_, this));
 	monitor_.setInterval(500);
+	monitor_.setSlack(TOP_APP_PROBE_SLACK_MS);
 	monitor_.start();
-	notifier_.setTimeOutCallback(std::bind(&TopAppMonitor::NotifierTask_, this));
-	notifier_.setInterval(1000);
-	notifier_.start();
 }
 
-void TopAppMonitor::MonitorLoop_()
+void TopAppMonitor::MonitorTimeOut_()
 {
-	CU::SetThreadName("TopAppMonitor");
-	CU::SetTaskSchedPrio(0, 95);
+	// Pause before probing so that a cgroup change during the probe schedules another one.
+	monitor_.pauseTimer();
+	probeThread_.Post(std::bind(&TopAppMonitor::ProbeTopApp_, this));
+}
 
-	TIMER_LOOP(monitor_) {
-		int newTopAppPid = -1;
-		auto topAppInfo = DumpTopActivityInfo();
-		if (CU::StrContains(topAppInfo, "fore")) {
-			// Proc # 0: fore   T/A/TOP  trm: 0 4272:xyz.chenzyadb.cu_toolbox/u0a353 (top-activity)
-			int pid = CU::StrToInt(CU::SubPrevStr(CU::StrSplitAt(topAppInfo, ' ', 7), ':'));
-			if (pid > 0 && pid < (INT16_MAX + 1)) {
-				newTopAppPid = pid;
-			}
-		} else if (CU::StrContains(topAppInfo, "fg")) {
-			// Proc # 0: fg     T/A/TOP  LCM  t: 0 4272:xyz.chenzyadb.cu_toolbox/u0a353 (top-activity)
-			int pid = CU::StrToInt(CU::SubPrevStr(CU::StrSplitAt(topAppInfo, ' ', 8), ':'));
-			if (pid > 0 && pid < (INT16_MAX + 1)) {
-				newTopAppPid = pid;
-			}
+void TopAppMonitor::ProbeTopApp_()
+{
+	int newTopAppPid = -1;
+	auto topAppInfoStr = DumpTopActivityInfo();
+	std::string_view topAppInfo(topAppInfoStr);
+	if (CU::StrContains(topAppInfo, "fore")) {
+		// Proc # 0: fore   T/A/TOP  trm: 0 4272:xyz.chenzyadb.cu_toolbox/u0a353 (top-activity)
+		int pid = CU::StrToInt(CU::SubPrevStr(CU::StrSplitAt(topAppInfo, ' ', 7), ':'));
+		if (pid > 0 && pid < (INT16_MAX + 1)) {
+			newTopAppPid = pid;
+		}
+	} else if (CU::StrContains(topAppInfo, "fg")) {
+		// Proc # 0: fg     T/A/TOP  LCM  t: 0 4272:xyz.chenzyadb.cu_toolbox/u0a353 (top-activity)
+		int pid = CU::StrToInt(CU::SubPrevStr(CU::StrSplitAt(topAppInfo, ' ', 8), ':'));
+		if (pid > 0 && pid < (INT16_MAX + 1)) {
+			newTopAppPid = pid;
 		}
-		if (newTopAppPid != -1 && newTopAppPid != topAppPid_) {
-			CU::EventTransfer::Post("TopAppMonitor.TopAppChanged", newTopAppPid);
-			topAppPid_ = newTopAppPid;
+	}
+	if (newTopAppPid != -1 && newTopAppPid != topAppPid_) {
+		auto packageName = GetPackageName_(newTopAppPid);
+		if (packageName.empty()) {
+			// Still named after zygote, probe again once it has been specialized.
+			monitor_.continueTimer();
+			return;
 		}
-		monitor_.pauseTimer();
+		CU::FlightRecorder::Record("topapp", newTopAppPid);
+		CU::EventTransfer::Post("TopAppMonitor.TopAppChanged", packageName);
+		topAppPid_ = newTopAppPid;
+		WatchTopAppPid_(newTopAppPid);
 	}
 }
 
@@ -50,10 +93,20 @@ void TopAppMonitor::CgroupModified_(const CU::EventTransfer::TransData &transDat
 	monitor_.continueTimer();
 }
 
-void TopAppMonitor::NotifierTask_()
+void TopAppMonitor::WatchTopAppPid_(int pid)
 {
-	if (!IsTopAppTask(topAppPid_)) {
-		CgroupModified_(nullptr);
+	// The pidfd turns readable when the process exits, kernels before 5.3 rely on cgroup and proc events.
+	if (topAppPidFd_ >= 0) {
+		FileWatcher_RemoveFdWatch(topAppPidFd_);
+		close(topAppPidFd_);
+		topAppPidFd_ = -1;
+	}
+	if (pid < 0) {
+		return;
+	}
+	topAppPidFd_ = static_cast<int>(syscall(__NR_pidfd_open, pid, 0));
+	if (topAppPidFd_ >= 0) {
+		FileWatcher_AddFdWatch(topAppPidFd_, std::bind(&TopAppMonitor::CgroupModified_, this, nullptr), true);
 	}
 }
 
@@ -61,26 +114,121 @@ void TopAppMonitor::ScreenStateChanged_(const CU::EventTransfer::TransData &tran
 {
 	auto screenState = CU::EventTransfer::GetData<ScreenState>(transData);
 	if (screenState == ScreenState::SCREEN_ON) {
-		notifier_.continueTimer();
+		CgroupModified_(nullptr);
 	} else {
-		notifier_.pauseTimer();
 		topAppPid_ = -1;
+		// An app exiting while the screen is off should not wake the probe.
+		probeThread_.Post(std::bind(&TopAppMonitor::WatchTopAppPid_, this, -1));
 	}
 }
 
-std::string TopAppMonitor::DumpTopActivityInfo()
+void TopAppMonitor::ProcessStarted_(const CU::EventTransfer::TransData &transData)
 {
-	auto lines = CU::StrSplit(CU::ExecCommand("dumpsys activity oom 2>/dev/null"), '\n');
-	for (const auto &line : lines) {
-		if (CU::StrContains(line, "(top-activity)")) {
-			return line;
-		}
+	// Runs on the FileWatcher thread, the cmdline is read from the probe thread and only for top-app pids.
+	int pid = CU::EventTransfer::GetData<int>(transData);
+	probeThread_.Post(std::bind(&TopAppMonitor::PrefetchPackage_, this, pid));
+}
+
+void TopAppMonitor::PrefetchPackage_(int pid)
+{
+	if (!InTopApp_(pid)) {
+		return;
+	}
+	auto cmdline = ReadCmdline_(pid);
+	if (IsPackageName_(cmdline)) {
+		packageCache_[pid] = cmdline;
+	}
+}
+
+void TopAppMonitor::ProcessExit_(const CU::EventTransfer::TransData &transData)
+{
+	int pid = CU::EventTransfer::GetData<int>(transData);
+	// Queued behind any prefetch of the same pid, a reused pid never sees the old entry.
+	probeThread_.Post(std::bind(&TopAppMonitor::ForgetPid_, this, pid));
+	if (pid == topAppPid_) {
+		CgroupModified_(nullptr);
 	}
-	return {};
 }
 
-bool TopAppMonitor::IsTopAppTask(int pid)
+void TopAppMonitor::ProcEventOverrun_(const CU::EventTransfer::TransData &transData)
 {
-	auto topAppProcs = CU::StrSplit(CU::ReadFile("/dev/cpuset/top-app/cgroup.procs"), '\n');
-	return CU::Contains(topAppProcs, CU::To_String(pid));
+	CU_UNUSED(transData);
+	probeThread_.Post([this]() {
+		packageCache_.clear();
+		// Missed exits may leave fds of recycled pids behind.
+		cmdlineFiles_.clear();
+	});
+}
+
+void TopAppMonitor::ForgetPid_(int pid)
+{
+	char cmdlinePath[32] = { 0 };
+	CU::FormatTo(cmdlinePath, CU_FMT("/proc/{}/cmdline"), pid);
+	packageCache_.erase(pid);
+	cmdlineFiles_.evict(cmdlinePath);
+}
+
+std::string TopAppMonitor::GetPackageName_(int pid)
+{
+	// The cmdline is always read, COMM is raised by pthread_setname_np before setArgv0 rewrites argv[0],
+	// so a prefetched name is only a hint that this read confirms or replaces.
+	auto cmdline = ReadCmdline_(pid);
+	if (!IsPackageName_(cmdline)) {
+		packageCache_.erase(pid);
+		return {};
+	}
+	auto iter = packageCache_.find(pid);
+	if (iter != packageCache_.end() && iter->second != cmdline) {
+		CU::Logger::Debug("Package of pid {} changed from {} to {}.", pid, iter->second, cmdline);
+	}
+	packageCache_[pid] = cmdline;
+	return cmdline;
+}
+
+std::string TopAppMonitor::ReadCmdline_(int pid)
+{
+	char cmdlinePath[32] = { 0 };
+	CU::FormatTo(cmdlinePath, CU_FMT("/proc/{}/cmdline"), pid);
+	auto cmdline = cmdlineFiles_.read(cmdlinePath);
+	// Only argv[0], the package name.
+	return std::string(cmdline.substr(0, cmdline.find('\0')));
+}
+
+bool TopAppMonitor::InTopApp_(int pid)
+{
+	char cpusetPath[32] = { 0 };
+	CU::FormatTo(cpusetPath, CU_FMT("/proc/{}/cpuset"), pid);
+	int fd = open(cpusetPath, (O_RDONLY | O_CLOEXEC));
+	if (fd < 0) {
+		return false;
+	}
+	char buffer[32] = { 0 };
+	auto len = read(fd, buffer, (sizeof(buffer) - 1));
+	close(fd);
+	return (len > 0 && CU::StrStartsWith(std::string_view(buffer, static_cast<size_t>(len)), "/top-app"));
+}
+
+bool TopAppMonitor::IsPackageName_(const std::string &cmdline)
+{
+	// Before specialization argv[0] is "zygote64", "usap64" or "<pre-initialized>", package names have a dot.
+	return (!cmdline.empty() && cmdline.front() != '/' && cmdline.front() != '<' && 
+		cmdline.find('.') != std::string::npos);
+}
+
+std::string TopAppMonitor::DumpTopActivityInfo()
+{
+	// Only called from probeThread_, dumpsys_ is never shared.
+	std::string topActivityInfo{};
+	auto result = dumpsys_.run({"dumpsys", "activity", "oom"}, DUMPSYS_TIMEOUT_MS, 
+		[&topActivityInfo](const std::string &line) -> bool {
+			if (CU::StrContains(line, "(top-activity)")) {
+				topActivityInfo = line;
+				return false;
+			}
+			return true;
+		});
+	if (result.timedOut) {
+		CU::Logger::Warn("dumpsys activity oom timed out after {} ms.", (result.elapsedNs / 1000000));
+	}
+	return topActivityInfo;
 }
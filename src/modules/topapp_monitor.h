@@ -1,13 +1,20 @@
 #pragma once
 
 #include "platform/module.h"
+#include "platform/serial_thread.h"
 #include "utils/libcu.h"
+#include "utils/CuFile.h"
+#include "utils/CuSubprocess.h"
 #include "utils/CuSched.h"
 #include "utils/CuLogger.h"
+#include "utils/CuFlightRecorder.h"
 #include "utils/CuEventTransfer.h"
 #include "utils/CuTimer.h"
 #include "utils/CuFormat.h"
 #include "utils/android_platform.h"
+#include <unordered_map>
+#include <atomic>
+#include <sys/syscall.h>
 
 class TopAppMonitor : public Module
 {
@@ -18,14 +25,30 @@ class TopAppMonitor : public Module
 		
 	private:
 		CU::Timer monitor_;
-		CU::Timer notifier_;
-		int topAppPid_;
+		// dumpsys blocks for up to DUMPSYS_TIMEOUT_MS, it gets its own thread instead of a pool thread.
+		SerialThread probeThread_;
+		// Read by the proc event and screen state callbacks, the pidfd is only touched from probeThread_.
+		std::atomic<int> topAppPid_;
+		int topAppPidFd_;
+		// Only touched from probeThread_.
+		std::unordered_map<int, std::string> packageCache_;
+		CU::KernelFileCache cmdlineFiles_;
+		CU::Subprocess dumpsys_;
 
-		void MonitorLoop_();
-		void NotifierTask_();
+		void MonitorTimeOut_();
+		void ProbeTopApp_();
 		void CgroupModified_(const CU::EventTransfer::TransData &transData);
 		void ScreenStateChanged_(const CU::EventTransfer::TransData &transData);
+		void ProcessStarted_(const CU::EventTransfer::TransData &transData);
+		void ProcessExit_(const CU::EventTransfer::TransData &transData);
+		void ProcEventOverrun_(const CU::EventTransfer::TransData &transData);
+		void PrefetchPackage_(int pid);
+		void ForgetPid_(int pid);
+		std::string GetPackageName_(int pid);
+		std::string ReadCmdline_(int pid);
+		static bool InTopApp_(int pid);
+		static bool IsPackageName_(const std::string &cmdline);
+		void WatchTopAppPid_(int pid);
 
 		std::string DumpTopActivityInfo();
-		bool IsTopAppTask(int pid);
 };
@@ -4,32 +4,41 @@
 #include "utils/libcu.h"
 #include "utils/CuSched.h"
 #include "utils/CuLogger.h"
+#include <unordered_map>
+#include <mutex>
 #include <unistd.h>
 #include <sys/inotify.h>
+#include <sys/epoll.h>
 
-class FileWatcher : public Singleton<FileWatcher> 
+class FileWatcher : public Singleton<FileWatcher>
 {
     public:
         using WatchNotifier = std::function<void(void)>;
 
-        FileWatcher() : watcherMap_(), inotify_fd_(inotify_init()) 
+        FileWatcher() : watcherMap_(), fdWatcherMap_(), mtx_(), inotify_fd_(inotify_init1(IN_CLOEXEC)), epoll_fd_(epoll_create1(EPOLL_CLOEXEC))
         {
-            if (inotify_fd_ < 0) {
+            if (inotify_fd_ < 0 || epoll_fd_ < 0) {
                 CU::Logger::Error("Failed to init inotify.");
                 CU::Logger::Flush();
                 std::exit(0);
             }
+            struct epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = inotify_fd_;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, inotify_fd_, std::addressof(event));
             std::thread thread_(std::bind(&FileWatcher::WatcherMain_, this));
             thread_.detach();
         }
 
         ~FileWatcher()
         {
+            close(epoll_fd_);
             close(inotify_fd_);
         }
 
         void AddWatch(const std::string &path, const WatchNotifier &notifier)
         {
+            std::unique_lock<std::mutex> lck(mtx_);
             int wd = inotify_add_watch(inotify_fd_, path.c_str(), IN_MODIFY);
             if (wd >= 0) {
                 watcherMap_.emplace(wd, notifier);
@@ -38,9 +47,40 @@ class FileWatcher : public Singleton<FileWatcher>
             }
         }
 
+        // Level-triggered unless oneShot, a one-shot watch is removed before its notifier runs.
+        void AddFdWatch(int fd, const WatchNotifier &notifier, bool oneShot = false)
+        {
+            std::unique_lock<std::mutex> lck(mtx_);
+            struct epoll_event event{};
+            event.events = oneShot ? (EPOLLIN | EPOLLONESHOT) : EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, std::addressof(event)) == 0) {
+                fdWatcherMap_[fd] = FdWatcher{notifier, oneShot};
+            } else {
+                CU::Logger::Warn("Failed to watch fd {}.", fd);
+            }
+        }
+
+        void RemoveFdWatch(int fd)
+        {
+            std::unique_lock<std::mutex> lck(mtx_);
+            if (fdWatcherMap_.erase(fd) > 0) {
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            }
+        }
+
     private:
+        struct FdWatcher
+        {
+            WatchNotifier notifier;
+            bool oneShot;
+        };
+
         std::unordered_map<int, WatchNotifier> watcherMap_;
+        std::unordered_map<int, FdWatcher> fdWatcherMap_;
+        std::mutex mtx_;
         int inotify_fd_;
+        int epoll_fd_;
 
         void WatcherMain_()
         {
@@ -48,22 +88,62 @@ class FileWatcher : public Singleton<FileWatcher>
             CU::SetTaskSchedPrio(0, 95);
 
             auto buffer = new inotify_event[128];
+            struct epoll_event events[16]{};
             for (;;) {
-                memset(buffer, 0, sizeof(inotify_event) * 128);
-                auto len = read(inotify_fd_, buffer, sizeof(inotify_event) * 128);
-                if (len >= 0) {
-                    off_t offset = 0;
-                    while ((sizeof(inotify_event) * offset) < len) {
-                        auto event = *(buffer + offset);
-                        watcherMap_.at(event.wd)();
-                        offset++;
+                int nfds = epoll_wait(epoll_fd_, events, 16, -1);
+                if (nfds < 0) {
+                    if (errno == EINTR) {
+                        continue;
                     }
-                } else {
-                    CU::Logger::Error("Failed to read inotify fd.");
+                    CU::Logger::Error("Failed to wait epoll fd.");
                     CU::Logger::Flush();
                     std::exit(0);
                 }
+                for (int idx = 0; idx < nfds; idx++) {
+                    int fd = events[idx].data.fd;
+                    if (fd == inotify_fd_) {
+                        ReadInotify_(buffer);
+                        continue;
+                    }
+                    WatchNotifier notifier{};
+                    {
+                        std::unique_lock<std::mutex> lck(mtx_);
+                        auto iter = fdWatcherMap_.find(fd);
+                        if (iter == fdWatcherMap_.end()) {
+                            continue;
+                        }
+                        notifier = iter->second.notifier;
+                        if (iter->second.oneShot) {
+                            fdWatcherMap_.erase(iter);
+                            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+                        }
+                    }
+                    notifier();
+                }
             }
             delete[] buffer;
         }
+
+        void ReadInotify_(inotify_event* buffer)
+        {
+            memset(buffer, 0, sizeof(inotify_event) * 128);
+            auto len = read(inotify_fd_, buffer, sizeof(inotify_event) * 128);
+            if (len >= 0) {
+                size_t offset = 0;
+                while ((sizeof(inotify_event) * offset) < static_cast<size_t>(len)) {
+                    auto event = *(buffer + offset);
+                    WatchNotifier notifier{};
+                    {
+                        std::unique_lock<std::mutex> lck(mtx_);
+                        notifier = watcherMap_.at(event.wd);
+                    }
+                    notifier();
+                    offset++;
+                }
+            } else if (errno != EINTR && errno != EAGAIN) {
+                CU::Logger::Error("Failed to read inotify fd.");
+                CU::Logger::Flush();
+                std::exit(0);
+            }
+        }
 };
@@ -16,8 +16,23 @@ class Module
 			FileWatcher::GetInstance()->AddWatch(path, wn);
 		}
 
-		void WorkerThread_AddWork(const WorkerThread::WorkTask &task) 
+		void FileWatcher_AddFdWatch(int fd, const FileWatcher::WatchNotifier &wn, bool oneShot = false)
 		{
-			WorkerThread::GetInstance()->AddWork(task);
+			FileWatcher::GetInstance()->AddFdWatch(fd, wn, oneShot);
+		}
+
+		void FileWatcher_RemoveFdWatch(int fd)
+		{
+			FileWatcher::GetInstance()->RemoveFdWatch(fd);
+		}
+
+		void WorkerThread_AddWork(
+			const WorkerThread::WorkTask &task, 
+			WorkerThread::WorkPriority priority = WorkerThread::WorkPriority::NORMAL, 
+			time_t deadlineMs = 0,
+			const std::string &key = {},
+			WorkerThread::CoalescePolicy policy = WorkerThread::CoalescePolicy::KEEP_POSITION) 
+		{
+			WorkerThread::GetInstance()->AddWork(task, priority, deadlineMs, key, policy);
 		}
 };
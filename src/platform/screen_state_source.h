@@ -0,0 +1,211 @@
+#pragma once
+
+#include "utils/libcu.h"
+#include "utils/CuFile.h"
+#include "utils/CuLogger.h"
+#include "utils/android_platform.h"
+#include <memory>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+class ScreenStateSource
+{
+    public:
+        ScreenStateSource() { }
+        virtual ~ScreenStateSource() { }
+        virtual const char* Name() const = 0;
+        virtual bool Available() const = 0;
+        virtual ScreenState Read() = 0;
+        // Cpusets whose changes may flip the result, CgroupWatcher only watches declared cgroups.
+        virtual std::vector<std::string> Cgroups() const = 0;
+        // Sources that cgroup events cannot wake have to be sampled, 0 means cgroup events are enough.
+        virtual time_t PollIntervalMs() const
+        {
+            return 0;
+        }
+};
+
+// The original heuristic, wake_unlock before Android R and the size of the restricted cpuset after.
+class LegacyScreenStateSource : public ScreenStateSource
+{
+    public:
+        LegacyScreenStateSource() : ScreenStateSource() { }
+
+        const char* Name() const override
+        {
+            return "legacy";
+        }
+
+        bool Available() const override
+        {
+            return true;
+        }
+
+        ScreenState Read() override
+        {
+            return GetScreenState();
+        }
+
+        std::vector<std::string> Cgroups() const override
+        {
+            if (android_get_device_api_level() >= __ANDROID_API_R__) {
+                return {"restricted"};
+            }
+            return {"background"};
+        }
+};
+
+// Counts the tasks of the restricted cpuset into a stack buffer, no allocation per read.
+// The file is opened on every read, a cgroup v1 pidlist is built on the first read of an fd
+// and an open fd keeps returning it (each read also extends its expiry).
+class TasksScreenStateSource : public ScreenStateSource
+{
+    public:
+        TasksScreenStateSource() : ScreenStateSource() { }
+
+        const char* Name() const override
+        {
+            return "tasks";
+        }
+
+        bool Available() const override
+        {
+            return (access(TASKS_PATH, R_OK) == 0 && android_get_device_api_level() >= __ANDROID_API_R__);
+        }
+
+        ScreenState Read() override
+        {
+            if (CountLines_() > 10) {
+                return ScreenState::SCREEN_OFF;
+            }
+            return ScreenState::SCREEN_ON;
+        }
+
+        std::vector<std::string> Cgroups() const override
+        {
+            return {"restricted"};
+        }
+
+    private:
+        static constexpr char TASKS_PATH[] = "/dev/cpuset/restricted/tasks";
+
+        size_t CountLines_()
+        {
+            int fd = open(TASKS_PATH, (O_RDONLY | O_CLOEXEC));
+            if (fd < 0) {
+                return 0;
+            }
+            char buffer[PAGE_SIZE];
+            size_t lines = 0;
+            for (;;) {
+                auto len = read(fd, buffer, sizeof(buffer));
+                if (len < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (len <= 0) {
+                    break;
+                }
+                lines += CU::CountChar(buffer, (buffer + len), '\n');
+            }
+            close(fd);
+            return lines;
+        }
+};
+
+// Samples the panel backlight, AOD keeps the panel lit and reads as screen on.
+// Nothing in the cgroups moves while the screen is off, so it is polled as well.
+class BacklightScreenStateSource : public ScreenStateSource
+{
+    public:
+        BacklightScreenStateSource() : ScreenStateSource(), fd_(-1), blPower_(false), screenState_(ScreenState::SCREEN_ON)
+        {
+            for (const auto &backlightPath : CU::ListPath("/sys/class/backlight", DT_LNK, true)) {
+                fd_ = open((backlightPath + "/brightness").c_str(), (O_RDONLY | O_CLOEXEC));
+                if (fd_ >= 0) {
+                    return;
+                }
+                fd_ = open((backlightPath + "/bl_power").c_str(), (O_RDONLY | O_CLOEXEC));
+                if (fd_ >= 0) {
+                    blPower_ = true;
+                    return;
+                }
+            }
+            fd_ = open("/sys/class/leds/lcd-backlight/brightness", (O_RDONLY | O_CLOEXEC));
+        }
+
+        ~BacklightScreenStateSource()
+        {
+            if (fd_ >= 0) {
+                close(fd_);
+            }
+        }
+
+        const char* Name() const override
+        {
+            return "backlight";
+        }
+
+        bool Available() const override
+        {
+            return (fd_ >= 0);
+        }
+
+        // A failed read keeps the last state, an error is not a state change.
+        ScreenState Read() override
+        {
+            char buffer[16] = { 0 };
+            ssize_t len = -1;
+            do {
+                len = pread(fd_, buffer, (sizeof(buffer) - 1), 0);
+            } while (len < 0 && errno == EINTR);
+            if (len <= 0) {
+                return screenState_;
+            }
+            int value = std::atoi(buffer);
+            // FB_BLANK_UNBLANK is 0 for bl_power, a zero brightness means the panel is off.
+            if ((blPower_ && value != 0) || (!blPower_ && value == 0)) {
+                screenState_ = ScreenState::SCREEN_OFF;
+            } else {
+                screenState_ = ScreenState::SCREEN_ON;
+            }
+            return screenState_;
+        }
+
+        std::vector<std::string> Cgroups() const override
+        {
+            return {"top-app", "foreground"};
+        }
+
+        time_t PollIntervalMs() const override
+        {
+            return BACKLIGHT_POLL_MS;
+        }
+
+    private:
+        // Waking the screen is noticed within this plus the debounce.
+        static constexpr time_t BACKLIGHT_POLL_MS = 500;
+
+        int fd_;
+        bool blPower_;
+        ScreenState screenState_;
+};
+
+// name: auto/tasks/backlight/legacy, falls back to the legacy heuristic when unavailable.
+inline std::unique_ptr<ScreenStateSource> CreateScreenStateSource(const std::string &name)
+{
+    std::unique_ptr<ScreenStateSource> source{};
+    if (name == "backlight") {
+        source = std::make_unique<BacklightScreenStateSource>();
+    } else if (name == "tasks" || name == "auto") {
+        source = std::make_unique<TasksScreenStateSource>();
+    }
+    if (!source || !source->Available()) {
+        if (source && name != "auto") {
+            CU::Logger::Warn("Screen state source \"{}\" is unavailable.", source->Name());
+        }
+        source = std::make_unique<LegacyScreenStateSource>();
+    }
+    CU::Logger::Info("Screen state source: {}.", source->Name());
+    return source;
+}
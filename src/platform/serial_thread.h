@@ -0,0 +1,63 @@
+#pragma once
+
+#include "utils/libcu.h"
+#include "utils/CuSched.h"
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+// A serial queue with a thread of its own, for tasks that block (subprocesses) and must not hold a pool thread.
+class SerialThread
+{
+    public:
+        using SerialTask = std::function<void(void)>;
+
+        // The thread starts on the first Post().
+        SerialThread(const std::string &name) : name_(name), mtx_(), cv_(), tasks_(), started_(false) { }
+        SerialThread(const SerialThread &other) = delete;
+        SerialThread &operator=(const SerialThread &other) = delete;
+
+        void Post(SerialTask &&task)
+        {
+            std::unique_lock<std::mutex> lck(mtx_);
+            tasks_.emplace_back(std::move(task));
+            if (!started_) {
+                started_ = true;
+                std::thread thread_(std::bind(&SerialThread::Main_, this));
+                thread_.detach();
+                return;
+            }
+            cv_.notify_one();
+        }
+
+        void Post(const SerialTask &task)
+        {
+            Post(SerialTask(task));
+        }
+
+    private:
+        std::string name_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::deque<SerialTask> tasks_;
+        bool started_;
+
+        void Main_()
+        {
+            CU::SetThreadName(name_);
+            CU::SetTaskSchedPrio(0, 95);
+            for (;;) {
+                SerialTask task{};
+                {
+                    std::unique_lock<std::mutex> lck(mtx_);
+                    while (tasks_.empty()) {
+                        cv_.wait(lck);
+                    }
+                    task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                }
+                task();
+            }
+        }
+};
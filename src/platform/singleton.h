@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 template <class T>
 class Singleton {
     public:
@@ -8,12 +10,15 @@ class Singleton {
         Singleton(Singleton &&other) = delete;
         Singleton &operator=(const Singleton &other) = delete;
 
+        // Built with -fno-threadsafe-statics and first reached from several threads (Strand::Post),
+        // so construction is guarded explicitly.
         static T* GetInstance() 
         {
             static T* instance = nullptr;
-            if (instance == nullptr) {
+            static std::once_flag flag{};
+            std::call_once(flag, []() {
                 instance = new T();
-            }
+            });
             return instance;
         }
 };
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <mutex>
+#include <deque>
+
+// A serial queue multiplexed onto the ThreadPool, tasks of one strand never overlap and run in order.
+class Strand
+{
+    public:
+        using StrandTask = std::function<void(void)>;
+
+        Strand() : mtx_(), tasks_(), scheduled_(false) { }
+        Strand(const Strand &other) = delete;
+        Strand &operator=(const Strand &other) = delete;
+
+        void Post(StrandTask &&task)
+        {
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                tasks_.emplace_back(std::move(task));
+                if (scheduled_) {
+                    return;
+                }
+                scheduled_ = true;
+            }
+            ThreadPool::GetInstance()->Submit(std::bind(&Strand::Drain_, this));
+        }
+
+        void Post(const StrandTask &task)
+        {
+            Post(StrandTask(task));
+        }
+
+    private:
+        std::mutex mtx_;
+        std::deque<StrandTask> tasks_;
+        bool scheduled_;
+
+        void Drain_()
+        {
+            for (;;) {
+                StrandTask task{};
+                {
+                    std::unique_lock<std::mutex> lck(mtx_);
+                    if (tasks_.empty()) {
+                        scheduled_ = false;
+                        return;
+                    }
+                    task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                }
+                task();
+            }
+        }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "singleton.h"
+#include "utils/libcu.h"
+#include "utils/CuSched.h"
+#include "utils/CuFormat.h"
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+
+// Shared by the strands. A strand holds at most one pool thread at a time, so the pool never needs more threads
+// than strands. Only short tasks belong here: the WorkerThread strand may block on a SurfaceFlinger
+// service call (up to 3 x 2 s), work that blocks longer (dumpsys) runs on a SerialThread of its own.
+class ThreadPool : public Singleton<ThreadPool>
+{
+    public:
+        using PoolTask = std::function<void(void)>;
+
+        // Must be called before the first GetInstance(), an empty cpu list leaves the threads unpinned.
+        static void Configure(size_t size, const std::vector<int> &cpus)
+        {
+            Options_().size = std::max<size_t>(size, 1);
+            Options_().cpus = cpus;
+        }
+
+        ThreadPool() : mtx_(), cv_(), tasks_()
+        {
+            const auto &options = Options_();
+            for (size_t idx = 0; idx < options.size; idx++) {
+                std::thread thread_(std::bind(&ThreadPool::Main_, this, idx));
+                thread_.detach();
+            }
+        }
+
+        void Submit(PoolTask &&task)
+        {
+            std::unique_lock<std::mutex> lck(mtx_);
+            tasks_.emplace_back(std::move(task));
+            cv_.notify_one();
+        }
+
+        size_t Size() const
+        {
+            return Options_().size;
+        }
+
+    private:
+        struct PoolOptions
+        {
+            size_t size;
+            std::vector<int> cpus;
+        };
+
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::deque<PoolTask> tasks_;
+
+        static PoolOptions &Options_()
+        {
+            static PoolOptions options{2, {}};
+            return options;
+        }
+
+        void Main_(size_t idx)
+        {
+            CU::SetThreadName(CU::Format(CU_FMT("ThreadPool#{}"), idx));
+            CU::SetTaskSchedPrio(0, 95);
+            if (!Options_().cpus.empty()) {
+                CU::SchedAffinity(Options_().cpus).toTask(0);
+            }
+            for (;;) {
+                PoolTask task{};
+                {
+                    std::unique_lock<std::mutex> lck(mtx_);
+                    while (tasks_.empty()) {
+                        cv_.wait(lck);
+                    }
+                    task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                }
+                task();
+            }
+        }
+};
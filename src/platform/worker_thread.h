@@ -1,51 +1,130 @@
 #pragma once
 
 #include "singleton.h"
+#include "strand.h"
 #include "utils/libcu.h"
 #include "utils/CuSched.h"
 #include <mutex>
-#include <condition_variable>
+#include <list>
+#include <atomic>
+#include <unordered_map>
 
-class WorkerThread : public Singleton<WorkerThread> 
+class WorkerThread : public Singleton<WorkerThread>
 {
     public:
         using WorkTask = std::function<void(void)>;
 
-        WorkerThread() : mtx_(), cv_(), tasks_()
+        // LATENCY_CRITICAL tasks run before NORMAL ones, BACKGROUND tasks run last.
+        enum class WorkPriority : uint8_t {LATENCY_CRITICAL, NORMAL, BACKGROUND};
+        // How a task replaces a pending one with the same key.
+        enum class CoalescePolicy : uint8_t {KEEP_POSITION, MOVE_TO_TAIL};
+
+        struct WorkStats
         {
-            std::thread thread_(std::bind(&WorkerThread::Main_, this));
-            thread_.detach();
-        }   
+            uint64_t enqueued;
+            uint64_t coalesced;
+            uint64_t executed;
+            uint64_t expired;
+        };
+
+        WorkerThread() : mtx_(), strand_(), queues_(), pendingKeys_(), enqueued_(0), coalesced_(0), executed_(0), expired_(0) { }
 
-        void AddWork(const WorkTask &task) 
+        // A task that could not start within deadlineMs (0 = none) is dropped.
+        // A non-empty key supersedes the pending task with the same key instead of queueing a copy.
+        void AddWork(
+            const WorkTask &task,
+            WorkPriority priority = WorkPriority::NORMAL,
+            time_t deadlineMs = 0,
+            const std::string &key = {},
+            CoalescePolicy policy = CoalescePolicy::KEEP_POSITION)
         {
+            WorkItem item{};
+            item.task = task;
+            item.key = key;
+            item.priority = priority;
+            if (deadlineMs > 0) {
+                item.deadline = CU::Clock::Default()->monotonicMs() + deadlineMs;
+            } else {
+                item.deadline = INT64_MAX;
+            }
+            enqueued_++;
+
             std::unique_lock<std::mutex> lck(mtx_);
-            tasks_.emplace_back(task);
-            cv_.notify_all();
+            auto &queue = queues_[static_cast<size_t>(priority)];
+            if (!key.empty()) {
+                auto keyIter = pendingKeys_.find(key);
+                if (keyIter != pendingKeys_.end()) {
+                    auto pendingIter = keyIter->second;
+                    auto &pendingQueue = queues_[static_cast<size_t>(pendingIter->priority)];
+                    *pendingIter = std::move(item);
+                    if (policy == CoalescePolicy::MOVE_TO_TAIL || std::addressof(pendingQueue) != std::addressof(queue)) {
+                        queue.splice(queue.end(), pendingQueue, pendingIter);
+                    }
+                    coalesced_++;
+                    return;
+                }
+                queue.emplace_back(std::move(item));
+                pendingKeys_.emplace(key, std::prev(queue.end()));
+            } else {
+                queue.emplace_back(std::move(item));
+            }
+            lck.unlock();
+            // One run per queued item, coalesced items reuse the run of the item they replaced.
+            strand_.Post(std::bind(&WorkerThread::RunWork_, this));
+        }
+
+        WorkStats GetStats() const
+        {
+            return WorkStats{enqueued_.load(), coalesced_.load(), executed_.load(), expired_.load()};
         }
 
     private:
+        struct WorkItem
+        {
+            WorkTask task;
+            std::string key;
+            WorkPriority priority;
+            int64_t deadline;
+        };
+
         std::mutex mtx_;
-        std::condition_variable cv_;
-        std::vector<WorkTask> tasks_;
+        Strand strand_;
+        std::list<WorkItem> queues_[3];
+        std::unordered_map<std::string, std::list<WorkItem>::iterator> pendingKeys_;
+        std::atomic<uint64_t> enqueued_;
+        std::atomic<uint64_t> coalesced_;
+        std::atomic<uint64_t> executed_;
+        std::atomic<uint64_t> expired_;
 
-        void Main_()
+        bool PopWork_(WorkItem &item)
         {
-            CU::SetThreadName("WorkerThread");
-            CU::SetTaskSchedPrio(0, 95);
-            for (;;) {
-                std::vector<WorkTask> runTasks{};
-                {
-                    std::unique_lock<std::mutex> lck(mtx_);
-                    while (tasks_.size() == 0) {
-                        cv_.wait(lck);
+            for (auto &queue : queues_) {
+                if (!queue.empty()) {
+                    item = std::move(queue.front());
+                    queue.pop_front();
+                    if (!item.key.empty()) {
+                        pendingKeys_.erase(item.key);
                     }
-                    runTasks = tasks_;
-                    tasks_.clear();
+                    return true;
                 }
-                for (const auto &task : runTasks) {
-                    task();
+            }
+            return false;
+        }
+
+        void RunWork_()
+        {
+            WorkItem item{};
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                if (!PopWork_(item)) {
+                    return;
                 }
             }
+            if (CU::Clock::Default()->monotonicMs() <= item.deadline) {
+                item.task();
+                executed_++;
+            } else {
+                expired_++;
+            }
         }
 };
@@ -0,0 +1,245 @@
+// CuCharConv by chenzyadb@github.com
+// Based on C++17 STL (LLVM)
+
+#ifndef _CU_CHAR_CONV_
+#define _CU_CHAR_CONV_
+
+#include <string>
+#include <string_view>
+#include <limits>
+#include <type_traits>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// Shortest round-trip std::to_chars(double) arrived in libc++ 14 and libstdc++ 11.
+#if (defined(_LIBCPP_VERSION) && _LIBCPP_VERSION >= 14000) || (defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L)
+#define _CU_FLOAT_TO_CHARS 1
+#endif
+
+namespace CU
+{
+    inline constexpr char _Digit_Pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    inline constexpr double _Exact_Pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // Room for any 64-bit integer with its sign.
+    constexpr size_t INT_CHARS_MAX = 21;
+    // Room for the shortest round-trip form of any double.
+    constexpr size_t DOUBLE_CHARS_MAX = 32;
+
+    inline int _Count_Digits(uint64_t value) noexcept
+    {
+        int digits = 1;
+        for (;;) {
+            if (value < 10) {
+                return digits;
+            }
+            if (value < 100) {
+                return (digits + 1);
+            }
+            if (value < 1000) {
+                return (digits + 2);
+            }
+            if (value < 10000) {
+                return (digits + 3);
+            }
+            value /= 10000;
+            digits += 4;
+        }
+    }
+
+    // Writes without a terminating NUL, returns the end. Needs INT_CHARS_MAX bytes.
+    template <typename _Ty>
+    inline char* IntToChars(char* first, _Ty value) noexcept
+    {
+        static_assert(std::is_integral<_Ty>::value, "IntToChars needs an integer.");
+        typedef typename std::make_unsigned<_Ty>::type _Unsigned_Ty;
+
+        auto absValue = static_cast<uint64_t>(static_cast<_Unsigned_Ty>(value));
+        if constexpr (std::is_signed<_Ty>::value) {
+            if (value < 0) {
+                *first = '-';
+                first++;
+                absValue = static_cast<uint64_t>(0) - static_cast<uint64_t>(static_cast<int64_t>(value));
+            }
+        }
+        auto last = first + _Count_Digits(absValue);
+        auto pos = last;
+        while (absValue >= 100) {
+            auto pair = static_cast<size_t>(absValue % 100) * 2;
+            absValue /= 100;
+            pos -= 2;
+            pos[0] = _Digit_Pairs[pair];
+            pos[1] = _Digit_Pairs[pair + 1];
+        }
+        if (absValue >= 10) {
+            auto pair = static_cast<size_t>(absValue) * 2;
+            pos[-2] = _Digit_Pairs[pair];
+            pos[-1] = _Digit_Pairs[pair + 1];
+        } else {
+            pos[-1] = static_cast<char>('0' + absValue);
+        }
+        return last;
+    }
+
+    // Shortest text that reads back to the same double, without a terminating NUL. Needs DOUBLE_CHARS_MAX bytes.
+    inline char* DoubleToChars(char* first, double value) noexcept
+    {
+#if defined(_CU_FLOAT_TO_CHARS)
+        return std::to_chars(first, (first + DOUBLE_CHARS_MAX), value).ptr;
+#else
+        int len = std::snprintf(first, DOUBLE_CHARS_MAX, "%.15g", value);
+        if (std::strtod(first, nullptr) != value) {
+            len = std::snprintf(first, DOUBLE_CHARS_MAX, "%.17g", value);
+        }
+        return (first + len);
+#endif
+    }
+
+    // Parses [+-]digits like strtol in base 10 but needs no terminating NUL and ignores the locale.
+    // Saturates on overflow, returns the end of the parsed text or nullptr if there were no digits.
+    template <typename _Ty>
+    inline const char* ParseInt(std::string_view str, _Ty &value) noexcept
+    {
+        static_assert(std::is_integral<_Ty>::value, "ParseInt needs an integer.");
+
+        auto pos = str.data();
+        auto end = str.data() + str.size();
+        while (pos < end && (*pos == ' ' || (*pos >= '\t' && *pos <= '\r'))) {
+            pos++;
+        }
+        bool negative = false;
+        if (pos < end && (*pos == '-' || *pos == '+')) {
+            negative = (*pos == '-');
+            pos++;
+        }
+        auto digitsBegin = pos;
+        uint64_t absValue = 0;
+        bool overflow = false;
+        while (pos < end && static_cast<unsigned>(*pos - '0') < 10) {
+            auto digit = static_cast<uint64_t>(*pos - '0');
+            if (absValue > (UINT64_MAX - digit) / 10) {
+                overflow = true;
+            } else {
+                absValue = absValue * 10 + digit;
+            }
+            pos++;
+        }
+        if (pos == digitsBegin) {
+            value = 0;
+            return nullptr;
+        }
+        if constexpr (std::is_signed<_Ty>::value) {
+            constexpr auto maxValue = static_cast<uint64_t>(std::numeric_limits<_Ty>::max());
+            if (negative) {
+                value = (overflow || absValue > (maxValue + 1)) ? std::numeric_limits<_Ty>::min() :
+                    static_cast<_Ty>(static_cast<int64_t>(static_cast<uint64_t>(0) - absValue));
+            } else {
+                value = (overflow || absValue > maxValue) ? std::numeric_limits<_Ty>::max() : static_cast<_Ty>(absValue);
+            }
+        } else {
+            // Same as strtoull, a minus sign negates modulo 2^64.
+            constexpr auto maxValue = static_cast<uint64_t>(std::numeric_limits<_Ty>::max());
+            if (overflow || absValue > maxValue) {
+                value = std::numeric_limits<_Ty>::max();
+            } else {
+                value = negative ? static_cast<_Ty>(static_cast<uint64_t>(0) - absValue) : static_cast<_Ty>(absValue);
+            }
+        }
+        return pos;
+    }
+
+    // Plain decimals with few significant digits are converted exactly in registers,
+    // anything else (long mantissas, large exponents, inf, nan, hex) goes through strtod.
+    inline const char* ParseDouble(std::string_view str, double &value) noexcept
+    {
+        auto pos = str.data();
+        auto end = str.data() + str.size();
+        while (pos < end && (*pos == ' ' || (*pos >= '\t' && *pos <= '\r'))) {
+            pos++;
+        }
+        auto begin = pos;
+        bool negative = false;
+        if (pos < end && (*pos == '-' || *pos == '+')) {
+            negative = (*pos == '-');
+            pos++;
+        }
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool hasDigits = false;
+        while (pos < end && static_cast<unsigned>(*pos - '0') < 10) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*pos - '0');
+            digits += (mantissa != 0);
+            hasDigits = true;
+            pos++;
+        }
+        if (pos < end && *pos == '.') {
+            pos++;
+            while (pos < end && static_cast<unsigned>(*pos - '0') < 10) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*pos - '0');
+                digits += (mantissa != 0);
+                exponent--;
+                hasDigits = true;
+                pos++;
+            }
+        }
+        bool fastPath = hasDigits && digits <= 15;
+        if (fastPath && pos < end && (*pos == 'e' || *pos == 'E')) {
+            auto expPos = pos + 1;
+            bool expNegative = false;
+            if (expPos < end && (*expPos == '-' || *expPos == '+')) {
+                expNegative = (*expPos == '-');
+                expPos++;
+            }
+            if (expPos < end && static_cast<unsigned>(*expPos - '0') < 10) {
+                int expValue = 0;
+                while (expPos < end && static_cast<unsigned>(*expPos - '0') < 10) {
+                    if (expValue < 10000) {
+                        expValue = expValue * 10 + (*expPos - '0');
+                    }
+                    expPos++;
+                }
+                exponent += expNegative ? -expValue : expValue;
+                pos = expPos;
+            }
+        }
+        if (fastPath && pos < end && (*pos == 'x' || *pos == 'X' || *pos == 'p' || *pos == 'P')) {
+            fastPath = false;
+        }
+        if (fastPath && exponent >= -22 && exponent <= 22) {
+            auto result = static_cast<double>(mantissa);
+            result = (exponent < 0) ? (result / _Exact_Pow10[-exponent]) : (result * _Exact_Pow10[exponent]);
+            value = negative ? -result : result;
+            return pos;
+        }
+
+        char buffer[64] = { 0 };
+        std::string heapBuffer{};
+        const char* text = buffer;
+        auto len = static_cast<size_t>(end - begin);
+        if (len < sizeof(buffer)) {
+            std::memcpy(buffer, begin, len);
+        } else {
+            heapBuffer.assign(begin, len);
+            text = heapBuffer.c_str();
+        }
+        char* textEnd = nullptr;
+        value = std::strtod(text, std::addressof(textEnd));
+        if (textEnd == text) {
+            return nullptr;
+        }
+        return (begin + (textEnd - text));
+    }
+}
+
+#endif // _CU_CHAR_CONV_
@@ -0,0 +1,201 @@
+// CuClock by chenzyadb@github.com
+// Based on C++17 STL (LLVM)
+
+#ifndef _CU_CLOCK_
+#define _CU_CLOCK_
+
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+
+namespace CU
+{
+    // Something that schedules on a clock, a VirtualClock steps through its deadlines when advanced.
+    class ClockListener
+    {
+        public:
+            virtual ~ClockListener() { }
+            // Next monotonic deadline in ns, INT64_MAX for none.
+            virtual int64_t nextDeadline() = 0;
+            virtual void clockAdvanced() = 0;
+    };
+
+    class Clock
+    {
+        public:
+            virtual ~Clock() { }
+
+            // Never goes backwards, unaffected by wall clock changes.
+            virtual int64_t monotonicNs() const = 0;
+            // Wall clock, only meant for display.
+            virtual int64_t realtimeNs() const = 0;
+
+            // Returns false if the clock runs by itself and listeners have to arm their own wakeups.
+            virtual bool attach(ClockListener* listener)
+            {
+                (void)listener;
+                return false;
+            }
+
+            int64_t monotonicMs() const
+            {
+                return (monotonicNs() / 1000000LL);
+            }
+
+            time_t realtime() const
+            {
+                return static_cast<time_t>(realtimeNs() / 1000000000LL);
+            }
+
+            // The precise clock, CLOCK_MONOTONIC unless a clock was installed.
+            static Clock* Default();
+            // A cheaper clock with tick resolution for paths that do not need better.
+            static Clock* Coarse();
+
+            // Replaces both clocks process-wide, must happen before anything reads the time.
+            static void Install(Clock* clock)
+            {
+                Installed_().store(clock);
+            }
+
+        private:
+            static std::atomic<Clock*> &Installed_()
+            {
+                static std::atomic<Clock*> installed{nullptr};
+                return installed;
+            }
+    };
+
+    class MonotonicClock : public Clock
+    {
+        public:
+            int64_t monotonicNs() const override
+            {
+#if defined(__linux__)
+                return Read_(CLOCK_MONOTONIC);
+#else
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+            }
+
+            int64_t realtimeNs() const override
+            {
+#if defined(__linux__)
+                return Read_(CLOCK_REALTIME);
+#else
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+#endif
+            }
+
+        protected:
+#if defined(__linux__)
+            static int64_t Read_(clockid_t clockId)
+            {
+                struct timespec ts{};
+                clock_gettime(clockId, std::addressof(ts));
+                return (static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec);
+            }
+#endif
+    };
+
+    // CLOCK_MONOTONIC_COARSE is served from the vDSO without reading the hardware counter.
+    class CoarseMonotonicClock : public MonotonicClock
+    {
+        public:
+#if defined(__linux__)
+            int64_t monotonicNs() const override
+            {
+                return Read_(CLOCK_MONOTONIC_COARSE);
+            }
+
+            int64_t realtimeNs() const override
+            {
+                return Read_(CLOCK_REALTIME_COARSE);
+            }
+#endif
+    };
+
+    // Time only moves when advance() is called, scheduled timers fire on the advancing thread
+    // in deadline order, so hours of daemon time pass in milliseconds.
+    class VirtualClock : public Clock
+    {
+        public:
+            VirtualClock() : now_(0), wallOrigin_(MonotonicClock().realtimeNs()), advanceMtx_(), mtx_(), listeners_() { }
+
+            int64_t monotonicNs() const override
+            {
+                return now_.load();
+            }
+
+            int64_t realtimeNs() const override
+            {
+                return (wallOrigin_ + now_.load());
+            }
+
+            bool attach(ClockListener* listener) override
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                listeners_.emplace_back(listener);
+                return true;
+            }
+
+            void advance(int64_t ms)
+            {
+                std::unique_lock<std::mutex> advanceLck(advanceMtx_);
+                int64_t target = now_.load() + ms * 1000000LL;
+                for (;;) {
+                    int64_t nextDeadline = INT64_MAX;
+                    for (auto listener : Listeners_()) {
+                        nextDeadline = std::min(nextDeadline, listener->nextDeadline());
+                    }
+                    if (nextDeadline > target) {
+                        break;
+                    }
+                    if (nextDeadline > now_.load()) {
+                        now_.store(nextDeadline);
+                    }
+                    for (auto listener : Listeners_()) {
+                        listener->clockAdvanced();
+                    }
+                }
+                now_.store(target);
+            }
+
+        private:
+            std::atomic<int64_t> now_;
+            const int64_t wallOrigin_;
+            std::mutex advanceMtx_;
+            std::mutex mtx_;
+            std::vector<ClockListener*> listeners_;
+
+            std::vector<ClockListener*> Listeners_()
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                return listeners_;
+            }
+    };
+
+    // Stateless, constant-initialized before any thread exists.
+    inline MonotonicClock DefaultMonotonicClock_{};
+    inline CoarseMonotonicClock DefaultCoarseClock_{};
+
+    inline Clock* Clock::Default()
+    {
+        auto installed = Installed_().load();
+        return (installed != nullptr) ? installed : std::addressof(DefaultMonotonicClock_);
+    }
+
+    inline Clock* Clock::Coarse()
+    {
+        auto installed = Installed_().load();
+        return (installed != nullptr) ? installed : std::addressof(DefaultCoarseClock_);
+    }
+}
+
+#endif // _CU_CLOCK_
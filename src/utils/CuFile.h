@@ -7,12 +7,19 @@
 #if defined(__unix__) && defined(__GNUC__)
 
 #include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <cerrno>
 #include <unistd.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 
 #define CU_INLINE __attribute__((always_inline)) inline
 #define CU_LIKELY(val) (__builtin_expect(!!(val), 1))
@@ -180,59 +187,301 @@ namespace CU
         }
     }
 
-    CU_INLINE std::string ReadFile(const std::string &filePath) 
+    CU_INLINE std::string ReadFile(const char* filePath) 
     {
         std::string content{};
-        int fd = open(filePath.c_str(), (O_RDONLY | O_NONBLOCK));
+        int fd = open(filePath, (O_RDONLY | O_NONBLOCK));
         if (CU_LIKELY(fd >= 0)) {
-            char buffer[PAGE_SIZE] = { 0 };
-            while (read(fd, buffer, (sizeof(buffer) - 1)) > 0) {
-                content += buffer;
-                CU_MEMSET(buffer, 0, sizeof(buffer));
+            char buffer[PAGE_SIZE];
+            ssize_t len = 0;
+            while ((len = read(fd, buffer, sizeof(buffer))) > 0) {
+                content.append(buffer, static_cast<size_t>(len));
             }
             close(fd);
+            // Callers compare against C strings, sysfs values may carry a trailing NUL.
+            content.resize(std::strlen(content.c_str()));
         }
         return content;
     }
 
+    CU_INLINE std::string ReadFile(const std::string &filePath) 
+    {
+        return ReadFile(filePath.c_str());
+    }
+
+    // Keeps frequently read procfs/sysfs files open, they regenerate their content on every read from offset 0.
+    // Only valid for such attribute files: cgroup v1 tasks/cgroup.procs keep serving the pidlist built by the
+    // first read of an open file, they must be opened fresh each time.
+    // Views stay valid until the next read on the same cache, a cache is not shared between threads.
+    class KernelFileCache
+    {
+        public:
+            CU_INLINE KernelFileCache(size_t maxFiles = 64) : files_(), key_(), buffer_(), maxFiles_(maxFiles), useCount_(0)
+            {
+                buffer_.resize(PAGE_SIZE);
+            }
+
+            CU_INLINE ~KernelFileCache()
+            {
+                clear();
+            }
+
+            KernelFileCache(const KernelFileCache &) = delete;
+            KernelFileCache &operator=(const KernelFileCache &) = delete;
+
+            // Empty when the file cannot be read. A file that vanished (ENOENT, ESRCH) is reopened once,
+            // the path may belong to a new owner by now (a reused pid).
+            CU_INLINE std::string_view read(const char* path)
+            {
+                key_.assign(path);
+                for (int attempt = 0; attempt < 2; attempt++) {
+                    auto iter = files_.find(key_);
+                    if (iter == files_.end()) {
+                        int fd = open(path, (O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+                        if (CU_UNLIKELY(fd < 0)) {
+                            return {};
+                        }
+                        if (files_.size() >= maxFiles_) {
+                            evictOldest_();
+                        }
+                        iter = files_.emplace(key_, CachedFile{fd, 0}).first;
+                    }
+                    iter->second.lastUse = ++useCount_;
+
+                    size_t length = 0;
+                    if (ReadAll_(iter->second.fd, length)) {
+                        // Sysfs values may carry a trailing NUL.
+                        while (length > 0 && buffer_[length - 1] == '\0') {
+                            length--;
+                        }
+                        return std::string_view(buffer_.data(), length);
+                    }
+                    if (errno != ENOENT && errno != ESRCH) {
+                        return {};
+                    }
+                    close(iter->second.fd);
+                    files_.erase(iter);
+                }
+                return {};
+            }
+
+            CU_INLINE std::string_view read(const std::string &path)
+            {
+                return read(path.c_str());
+            }
+
+            CU_INLINE void evict(const char* path)
+            {
+                key_.assign(path);
+                auto iter = files_.find(key_);
+                if (iter != files_.end()) {
+                    close(iter->second.fd);
+                    files_.erase(iter);
+                }
+            }
+
+            CU_INLINE void clear()
+            {
+                for (const auto &[path, file] : files_) {
+                    close(file.fd);
+                }
+                files_.clear();
+            }
+
+        private:
+            struct CachedFile
+            {
+                int fd;
+                uint64_t lastUse;
+            };
+
+            std::unordered_map<std::string, CachedFile> files_;
+            std::string key_;
+            std::string buffer_;
+            size_t maxFiles_;
+            uint64_t useCount_;
+
+            // Reads from offset 0 into buffer_, false with errno set on failure.
+            CU_INLINE bool ReadAll_(int fd, size_t &length)
+            {
+                for (;;) {
+                    if (length == buffer_.size()) {
+                        buffer_.resize(buffer_.size() * 2);
+                    }
+                    auto len = pread(fd, (buffer_.data() + length), (buffer_.size() - length), length);
+                    if (len > 0) {
+                        length += static_cast<size_t>(len);
+                        continue;
+                    }
+                    if (len == 0) {
+                        return true;
+                    }
+                    if (errno != EINTR) {
+                        return false;
+                    }
+                }
+            }
+
+            CU_INLINE void evictOldest_()
+            {
+                auto oldest = files_.begin();
+                for (auto iter = files_.begin(); iter != files_.end(); ++iter) {
+                    if (iter->second.lastUse < oldest->second.lastUse) {
+                        oldest = iter;
+                    }
+                }
+                if (oldest != files_.end()) {
+                    close(oldest->second.fd);
+                    files_.erase(oldest);
+                }
+            }
+    };
+
     CU_INLINE bool IsPathExists(const std::string &path) noexcept
     {
         struct stat buffer{};
         return (lstat(path.c_str(), std::addressof(buffer)) == 0);
     }
 
-    CU_INLINE std::vector<std::string> ListPath(const std::string &path, uint8_t d_type = DT_REG)
+    // Walks a directory with getdents64 into a reused buffer, in the order the filesystem returns entries.
+    // "." and ".." are skipped, names are only valid until the next call to next().
+    class DirReader
     {
-        std::vector<std::string> paths{};
-        struct dirent** entries = nullptr;
-        int size = scandir(path.c_str(), &entries, nullptr, alphasort);
-        if (CU_LIKELY(entries != nullptr)) {
-            for (int offset = 0; offset < size; offset++) {
-                auto entry = *(entries + offset);
-                if (entry->d_type == d_type) {
-                    paths.emplace_back(path + '/' + entry->d_name);
+        public:
+            // DT_UNKNOWN accepts every type.
+            CU_INLINE DirReader(const char* path, uint8_t d_type = DT_UNKNOWN) : 
+                fd_(-1), d_type_(d_type), buffer_(), bufferSize_(0), offset_(0), entry_(nullptr)
+            {
+                fd_ = open(path, (O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                if (CU_LIKELY(fd_ >= 0)) {
+                    buffer_.reset(new char[BUFFER_SIZE]);
+                }
+            }
+
+            CU_INLINE DirReader(const std::string &path, uint8_t d_type = DT_UNKNOWN) : DirReader(path.c_str(), d_type) { }
+
+            CU_INLINE ~DirReader()
+            {
+                if (fd_ >= 0) {
+                    close(fd_);
                 }
-                std::free(entry);
             }
-            std::free(entries);
+
+            DirReader(const DirReader &) = delete;
+            DirReader &operator=(const DirReader &) = delete;
+
+            CU_INLINE bool valid() const noexcept
+            {
+                return (fd_ >= 0);
+            }
+
+            CU_INLINE bool next()
+            {
+                if (CU_UNLIKELY(fd_ < 0)) {
+                    return false;
+                }
+                for (;;) {
+                    if (offset_ >= bufferSize_) {
+                        auto len = syscall(SYS_getdents64, fd_, buffer_.get(), BUFFER_SIZE);
+                        if (len <= 0) {
+                            entry_ = nullptr;
+                            return false;
+                        }
+                        bufferSize_ = static_cast<size_t>(len);
+                        offset_ = 0;
+                    }
+                    entry_ = reinterpret_cast<const Dirent64_*>(buffer_.get() + offset_);
+                    offset_ += entry_->d_reclen;
+                    auto name = entry_->d_name;
+                    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                        continue;
+                    }
+                    if (d_type_ == DT_UNKNOWN || type() == d_type_) {
+                        return true;
+                    }
+                }
+            }
+
+            CU_INLINE const char* name() const noexcept
+            {
+                return entry_->d_name;
+            }
+
+            // Filesystems without d_type in their entries are answered with fstatat.
+            CU_INLINE uint8_t type() const noexcept
+            {
+                if (CU_LIKELY(entry_->d_type != DT_UNKNOWN)) {
+                    return entry_->d_type;
+                }
+                struct stat buffer{};
+                if (fstatat(fd_, entry_->d_name, std::addressof(buffer), AT_SYMLINK_NOFOLLOW) != 0) {
+                    return DT_UNKNOWN;
+                }
+                return static_cast<uint8_t>(IFTODT(buffer.st_mode));
+            }
+
+            // The name as a decimal number, -1 unless it is all digits. Picks the pids out of /proc.
+            CU_INLINE int64_t number() const noexcept
+            {
+                auto name = entry_->d_name;
+                if (static_cast<unsigned>(name[0] - '0') >= 10) {
+                    return -1;
+                }
+                int64_t value = 0;
+                for (; *name != '\0'; name++) {
+                    auto digit = static_cast<unsigned>(*name - '0');
+                    if (digit >= 10 || value > (INT64_MAX / 10 - 1)) {
+                        return -1;
+                    }
+                    value = value * 10 + digit;
+                }
+                return value;
+            }
+
+        private:
+            struct Dirent64_
+            {
+                uint64_t d_ino;
+                int64_t d_off;
+                unsigned short d_reclen;
+                unsigned char d_type;
+                char d_name[];
+            };
+
+            // Room for about 1,000 /proc entries per syscall.
+            static constexpr size_t BUFFER_SIZE = 32768;
+
+            int fd_;
+            uint8_t d_type_;
+            std::unique_ptr<char[]> buffer_;
+            size_t bufferSize_;
+            size_t offset_;
+            const Dirent64_* entry_;
+    };
+
+    // Entries come in directory order, pass sorted when the order matters.
+    CU_INLINE std::vector<std::string> ListPath(const std::string &path, uint8_t d_type = DT_REG, bool sorted = false)
+    {
+        std::vector<std::string> paths{};
+        DirReader reader(path, d_type);
+        while (reader.next()) {
+            paths.emplace_back(path + '/' + reader.name());
+        }
+        if (sorted) {
+            std::sort(paths.begin(), paths.end());
         }
         return paths;
     }
 
-    CU_INLINE std::vector<std::string> ListFile(const std::string &path, uint8_t d_type = DT_REG)
+    CU_INLINE std::vector<std::string> ListFile(const std::string &path, uint8_t d_type = DT_REG, bool sorted = false)
     {
         std::vector<std::string> files{};
-        struct dirent** entries = nullptr;
-        int size = scandir(path.c_str(), &entries, nullptr, alphasort);
-        if (CU_LIKELY(entries != nullptr)) {
-            for (int offset = 0; offset < size; offset++) {
-                auto entry = *(entries + offset);
-                if (entry->d_type == d_type) {
-                    files.emplace_back(entry->d_name);
-                }
-                std::free(entry);
-            }
-            std::free(entries);
+        DirReader reader(path, d_type);
+        while (reader.next()) {
+            files.emplace_back(reader.name());
+        }
+        if (sorted) {
+            std::sort(files.begin(), files.end());
         }
         return files;
     }
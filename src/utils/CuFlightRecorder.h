@@ -0,0 +1,270 @@
+// CuFlightRecorder by chenzyadb@github.com
+// Based on C++17 STL (LLVM)
+
+#ifndef _CU_FLIGHT_RECORDER_
+#define _CU_FLIGHT_RECORDER_
+
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+#include <utility>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "CuClock.h"
+
+namespace CU
+{
+    // Log formats are recorded as offsets from here, they only decode with the binary that recorded them.
+    inline const char FlightRecorderAnchor_[] = "CuFlightRecorder";
+    inline const char FlightRecorderProbe_[] = "CuFlightRecorder.Probe";
+
+    // The last events before a crash, kept in a mapped file that survives the process.
+    // Recording is an index bump and four stores, readers skip records that were being written.
+    class FlightRecorder
+    {
+        public:
+            static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+            static bool Open(const std::string &path, size_t capacity = DEFAULT_CAPACITY)
+            {
+                return Instance_().open_(path, capacity);
+            }
+
+            // Tags are up to 8 characters, packed into the record.
+            template <size_t _Len>
+            static void Record(const char (&tag)[_Len], int64_t value)
+            {
+                static_assert(_Len <= (sizeof(uint64_t) + 1), "Flight recorder tag is too long.");
+                Instance_().record_(Tag_(tag), value);
+            }
+
+            // Level is the log tag character, E/W/I/D/V.
+            static void RecordLog(char level, const char* format)
+            {
+                uint64_t tag = Tag_("log.") | (static_cast<uint64_t>(static_cast<uint8_t>(level)) << 32);
+                Instance_().record_(tag, (format - FlightRecorderAnchor_));
+            }
+
+            static std::string Decode(const std::string &path)
+            {
+                std::string text{};
+                int fd = open(path.c_str(), (O_RDONLY | O_CLOEXEC));
+                if (fd < 0) {
+                    return text;
+                }
+                struct stat fileStat{};
+                if (fstat(fd, std::addressof(fileStat)) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(Header)) {
+                    close(fd);
+                    return text;
+                }
+                auto size = static_cast<size_t>(fileStat.st_size);
+                auto map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                close(fd);
+                if (map == MAP_FAILED) {
+                    return text;
+                }
+                auto header = static_cast<const Header*>(map);
+                auto records = reinterpret_cast<const RecordEntry*>(static_cast<const char*>(map) + sizeof(Header));
+                if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->capacity > 0 &&
+                    (size - sizeof(Header)) / sizeof(RecordEntry) >= header->capacity &&
+                    size >= (sizeof(Header) + header->capacity * sizeof(RecordEntry))
+                ) {
+                    std::vector<std::pair<uintptr_t, uintptr_t>> imageRanges{};
+                    if (header->probe == (FlightRecorderProbe_ - FlightRecorderAnchor_)) {
+                        imageRanges = ImageRanges_();
+                    }
+                    uint64_t capacity = header->capacity;
+                    uint64_t head = header->head.load(std::memory_order_acquire);
+                    for (auto idx = ((head > capacity) ? (head - capacity) : 0); idx < head; idx++) {
+                        const auto &entry = records[idx % capacity];
+                        if (entry.sequence.load(std::memory_order_acquire) != (idx + 1)) {
+                            continue;
+                        }
+                        auto timestamp = entry.timestamp;
+                        auto tag = entry.tag;
+                        auto value = entry.value;
+                        if (entry.sequence.load(std::memory_order_acquire) != (idx + 1)) {
+                            continue;
+                        }
+                        text += FormatRecord_((timestamp + header->wallOffset), tag, value, imageRanges);
+                    }
+                }
+                munmap(map, size);
+                return text;
+            }
+
+        private:
+            static constexpr char MAGIC[8] = {'C', 'U', 'F', 'R', 'E', 'C', '0', '1'};
+
+            struct Header
+            {
+                char magic[8];
+                uint64_t capacity;
+                int64_t wallOffset;
+                int64_t probe;
+                std::atomic<uint64_t> head;
+                char reserved[24];
+            };
+            static_assert(sizeof(Header) == 64, "Header should fill one cache line.");
+
+            struct RecordEntry
+            {
+                std::atomic<uint64_t> sequence;
+                int64_t timestamp;
+                uint64_t tag;
+                int64_t value;
+            };
+            static_assert(sizeof(RecordEntry) == 32, "Records should be 32 bytes.");
+
+            std::atomic<Header*> header_;
+            RecordEntry* records_;
+            uint64_t capacity_;
+
+            FlightRecorder() : header_(nullptr), records_(nullptr), capacity_(0) { }
+            FlightRecorder(FlightRecorder &) = delete;
+            FlightRecorder &operator=(FlightRecorder &) = delete;
+
+            static FlightRecorder &Instance_()
+            {
+                static FlightRecorder* instance = new FlightRecorder();
+                return *instance;
+            }
+
+            template <size_t _Len>
+            static constexpr uint64_t Tag_(const char (&tag)[_Len])
+            {
+                uint64_t packed = 0;
+                for (size_t idx = 0; idx < (_Len - 1); idx++) {
+                    packed |= (static_cast<uint64_t>(static_cast<uint8_t>(tag[idx])) << (idx * 8));
+                }
+                return packed;
+            }
+
+            // Readable mappings of our own executable, a recorded format outside of them is not dereferenced.
+            static std::vector<std::pair<uintptr_t, uintptr_t>> ImageRanges_()
+            {
+                std::vector<std::pair<uintptr_t, uintptr_t>> ranges{};
+                char exePath[PATH_MAX] = { 0 };
+                if (readlink("/proc/self/exe", exePath, (sizeof(exePath) - 1)) <= 0) {
+                    return ranges;
+                }
+                auto fp = std::fopen("/proc/self/maps", "r");
+                if (fp == nullptr) {
+                    return ranges;
+                }
+                char line[PATH_MAX + 128] = { 0 };
+                while (std::fgets(line, sizeof(line), fp) != nullptr) {
+                    unsigned long begin = 0, end = 0;
+                    char perms[8] = { 0 };
+                    int pathPos = 0;
+                    if (std::sscanf(line, "%lx-%lx %7s %*s %*s %*s %n", &begin, &end, perms, &pathPos) < 3 || perms[0] != 'r') {
+                        continue;
+                    }
+                    auto path = std::string(line + pathPos);
+                    if (!path.empty() && path.back() == '\n') {
+                        path.pop_back();
+                    }
+                    if (path == exePath) {
+                        ranges.emplace_back(begin, end);
+                    }
+                }
+                std::fclose(fp);
+                return ranges;
+            }
+
+            static const char* ImageString_(int64_t offset, const std::vector<std::pair<uintptr_t, uintptr_t>> &ranges)
+            {
+                auto addr = reinterpret_cast<uintptr_t>(FlightRecorderAnchor_) + static_cast<uintptr_t>(offset);
+                for (const auto &range : ranges) {
+                    if (addr >= range.first && addr < range.second) {
+                        auto str = reinterpret_cast<const char*>(addr);
+                        if (std::memchr(str, '\0', (range.second - addr)) != nullptr) {
+                            return str;
+                        }
+                    }
+                }
+                return nullptr;
+            }
+
+            static std::string FormatRecord_(int64_t wallNs, uint64_t tag, int64_t value, 
+                const std::vector<std::pair<uintptr_t, uintptr_t>> &imageRanges)
+            {
+                auto nowTime = static_cast<time_t>(wallNs / 1000000000LL);
+                struct tm localTime{};
+                localtime_r(std::addressof(nowTime), std::addressof(localTime));
+                char prefix[32] = { 0 };
+                std::snprintf(prefix, sizeof(prefix), "%02d-%02d %02d:%02d:%02d.%03d ",
+                    localTime.tm_mon + 1, localTime.tm_mday, localTime.tm_hour, localTime.tm_min, localTime.tm_sec,
+                    static_cast<int>((wallNs % 1000000000LL) / 1000000LL));
+                char name[sizeof(uint64_t) + 1] = { 0 };
+                std::memcpy(name, std::addressof(tag), sizeof(uint64_t));
+                std::string line(prefix);
+                line += name;
+                line += ' ';
+                if ((tag & UINT32_MAX) == Tag_("log.")) {
+                    auto format = ImageString_(value, imageRanges);
+                    line += (format != nullptr) ? format : "(format unavailable)";
+                } else {
+                    line += std::to_string(value);
+                }
+                line += '\n';
+                return line;
+            }
+
+            bool open_(const std::string &path, size_t capacity)
+            {
+                if (header_.load() != nullptr || capacity == 0) {
+                    return false;
+                }
+                int fd = open(path.c_str(), (O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC), 0644);
+                if (fd < 0) {
+                    return false;
+                }
+                auto size = sizeof(Header) + capacity * sizeof(RecordEntry);
+                if (ftruncate(fd, size) != 0) {
+                    close(fd);
+                    return false;
+                }
+                auto map = mmap(nullptr, size, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+                close(fd);
+                if (map == MAP_FAILED) {
+                    return false;
+                }
+                auto header = static_cast<Header*>(map);
+                std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+                header->capacity = capacity;
+                header->wallOffset = CU::Clock::Default()->realtimeNs() - CU::Clock::Default()->monotonicNs();
+                header->probe = FlightRecorderProbe_ - FlightRecorderAnchor_;
+                header->head.store(0);
+                records_ = reinterpret_cast<RecordEntry*>(static_cast<char*>(map) + sizeof(Header));
+                capacity_ = capacity;
+                header_.store(header, std::memory_order_release);
+                return true;
+            }
+
+            void record_(uint64_t tag, int64_t value)
+            {
+                auto header = header_.load(std::memory_order_acquire);
+                if (header == nullptr) {
+                    return;
+                }
+                auto idx = header->head.fetch_add(1, std::memory_order_relaxed);
+                auto &entry = records_[idx % capacity_];
+                entry.sequence.store(0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                entry.timestamp = CU::Clock::Default()->monotonicNs();
+                entry.tag = tag;
+                entry.value = value;
+                entry.sequence.store((idx + 1), std::memory_order_release);
+            }
+    };
+}
+
+#endif // _CU_FLIGHT_RECORDER_
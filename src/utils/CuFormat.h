@@ -1,5 +1,5 @@
 // CuFormat by chenzyadb@github.com
-// Based on C++11 STL (GNUC)
+// Based on C++17 STL (GNUC)
 
 #if !defined(_CU_FORMAT_)
 #define _CU_FORMAT_ 1
@@ -11,8 +11,19 @@
 #include <exception>
 #include <string>
 #include <vector>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <climits>
 #include <cstdio>
 #include <cstring>
+#include "CuCharConv.h"
+
+// Wraps a string literal so CU::Format parses it at compile time, e.g. CU::Format(CU_FMT("pid: {}"), pid).
+#define CU_FMT(str) ([]() { \
+    struct _Format_Literal : public CU::_Format_Literal_Tag { static constexpr const char* Value() { return str; } }; \
+    return _Format_Literal{}; \
+}())
 
 namespace CU 
 {
@@ -190,58 +201,26 @@ namespace CU
         return value;
     }
 
-    template <typename _Ty>
-    inline _Format_String _Decimal_To_String(_Ty value) noexcept
-    {
-        char buffer[16] = ".";
-        auto dec = (value - static_cast<size_t>(value)) * 10;
-        for (size_t pos = 1; pos < (sizeof(buffer) - 1); pos++) {
-            buffer[pos] = '0' + static_cast<char>(static_cast<size_t>(dec) % 10);
-            dec = (dec - static_cast<size_t>(dec)) * 10;
-            if (dec == 0) {
-                break;
-            }
-        }
-        return buffer;
-    }
-
     template <typename _Ty>
     inline _Format_String _Int_To_String(_Ty value) noexcept
     {
-        char buffer[32] = { 0 };
-        auto pos = sizeof(buffer) - 2;
-        if (value > 0) {
-            for (auto integer = value; integer > 0; integer /= 10) {
-                buffer[pos] = '0' + static_cast<char>(integer % 10);
-                pos--;
-            }
-            pos++;
-        } else if (value < 0) {
-            for (auto integer = -value; integer > 0; integer /= 10) {
-                buffer[pos] = '0' + static_cast<char>(integer % 10);
-                pos--;
-            }
-            buffer[pos] = '-';
-        } else {
-            buffer[pos] = '0';
-        }
-        return &buffer[pos];
+        char buffer[INT_CHARS_MAX + 1] = { 0 };
+        *IntToChars(buffer, value) = '\0';
+        return buffer;
     }
 
+    // Shortest round-trip form, integral values keep a trailing ".0".
     template <typename _Ty>
     inline _Format_String _Float_To_String(_Ty value) noexcept
     {
-        if (value < 0) {
-            _Format_String str("-");
-            str.append(_Int_To_String(static_cast<size_t>(-value)));
-            str.append(_Decimal_To_String(-value));
-            return str;
-        } else if (value > 0) {
-            _Format_String str(_Int_To_String(static_cast<size_t>(value)));
-            str.append(_Decimal_To_String(value));
-            return str;
+        char buffer[DOUBLE_CHARS_MAX + 3] = { 0 };
+        auto end = DoubleToChars(buffer, static_cast<double>(value));
+        if (std::strpbrk(buffer, ".einfa") == nullptr) {
+            *end++ = '.';
+            *end++ = '0';
         }
-        return "0";
+        *end = '\0';
+        return buffer;
     }
 
     template <typename _Ptr_Ty>
@@ -492,6 +471,222 @@ namespace CU
         return format;
     }
 
+    struct _Format_Literal_Tag { };
+
+    struct _Format_Span
+    {
+        size_t begin;
+        size_t length;
+        int arg_idx;
+        int max_length;
+    };
+
+    // A format string split into literal spans, each optionally followed by an argument slot.
+    template <size_t _Max_Spans>
+    struct _Format_Spec
+    {
+        _Format_Span spans[_Max_Spans];
+        size_t count;
+        int arg_count;
+        size_t literal_length;
+        bool valid;
+    };
+
+    constexpr int _Const_String_To_Int(const char* str, size_t pos) noexcept
+    {
+        int value = 0;
+        while (str[pos] >= '0' && str[pos] <= '9') {
+            value = value * 10 + (str[pos] - '0');
+            pos++;
+        }
+        return value;
+    }
+
+    // Same rules as _Format_Impl, evaluated by the compiler.
+    template <size_t _Len>
+    constexpr _Format_Spec<_Len + 1> _Parse_Format(const char* format) noexcept
+    {
+        _Format_Spec<_Len + 1> spec{};
+        spec.count = 1;
+        spec.valid = true;
+        auto closeSpan = [&spec](size_t next_begin) constexpr {
+            spec.literal_length += spec.spans[spec.count - 1].length;
+            spec.spans[spec.count] = {next_begin, 0, -1, INT_MAX};
+            spec.count++;
+        };
+        spec.spans[0] = {0, 0, -1, INT_MAX};
+        int placeholders = 0;
+        size_t pos = 0;
+        while (pos < _Len) {
+            auto &span = spec.spans[spec.count - 1];
+            if (format[pos] == '{' && (pos + 1) < _Len) {
+                if (format[pos + 1] == '{') {
+                    span.length++;
+                    closeSpan(pos + 2);
+                    pos += 2;
+                    continue;
+                }
+                size_t close_pos = pos + 1;
+                while (close_pos < _Len && format[close_pos] != '}') {
+                    close_pos++;
+                }
+                if (close_pos == _Len) {
+                    spec.valid = false;
+                    return spec;
+                }
+                auto ch = format[pos + 1];
+                if (ch == '}' || ch == ':') {
+                    span.arg_idx = placeholders;
+                } else if (ch >= '0' && ch <= '9') {
+                    span.arg_idx = _Const_String_To_Int(format, (pos + 1));
+                } else {
+                    spec.valid = false;
+                    return spec;
+                }
+                for (auto size_pos = pos + 1; size_pos < close_pos; size_pos++) {
+                    if (format[size_pos] == ':') {
+                        span.max_length = _Const_String_To_Int(format, (size_pos + 1));
+                        break;
+                    }
+                }
+                placeholders++;
+                if ((span.arg_idx + 1) > spec.arg_count) {
+                    spec.arg_count = span.arg_idx + 1;
+                }
+                closeSpan(close_pos + 1);
+                pos = close_pos + 1;
+            } else if (format[pos] == '}') {
+                if ((pos + 1) < _Len && format[pos + 1] == '}') {
+                    span.length++;
+                    closeSpan(pos + 2);
+                    pos += 2;
+                } else {
+                    spec.valid = false;
+                    return spec;
+                }
+            } else {
+                span.length++;
+                pos++;
+            }
+        }
+        spec.literal_length += spec.spans[spec.count - 1].length;
+        return spec;
+    }
+
+    // Writes into a caller-provided buffer, output past the end is cut off and the buffer stays NUL-terminated.
+    struct _Format_Buffer
+    {
+        char* data;
+        size_t size;
+        size_t length;
+
+        void append(const char* src, size_t src_len) noexcept
+        {
+            if ((length + src_len + 1) > size) {
+                src_len = (size > (length + 1)) ? (size - length - 1) : 0;
+            }
+            std::memcpy((data + length), src, src_len);
+            length += src_len;
+            data[length] = '\0';
+        }
+    };
+
+    template <typename _Out>
+    inline void _Append_Arg(_Out &content, const char* value, size_t length, int max_length)
+    {
+        if (max_length < INT_MAX && length > static_cast<size_t>(max_length)) {
+            length = static_cast<size_t>(max_length);
+        }
+        content.append(value, length);
+    }
+
+    template <typename _Out>
+    inline void _Append_Arg(_Out &content, const std::string &value, int max_length)
+    {
+        _Append_Arg(content, value.data(), value.size(), max_length);
+    }
+
+    template <typename _Out>
+    inline void _Append_Arg(_Out &content, const char* value, int max_length)
+    {
+        _Append_Arg(content, value, std::strlen(value), max_length);
+    }
+
+    template <typename _Out, typename _Ty>
+    inline void _Append_Arg(_Out &content, const _Ty &value, int max_length)
+    {
+        auto str = _To_Format_String(value);
+        _Append_Arg(content, str.data(), str.length, max_length);
+    }
+
+    template <typename _Fmt, typename _Out, typename _Args_Tuple, size_t... _Idx>
+    inline void _Format_Spans(_Out &content, const _Args_Tuple &args, std::index_sequence<_Idx...>)
+    {
+        static constexpr const char* format = _Fmt::Value();
+        static constexpr auto spec = _Parse_Format<std::char_traits<char>::length(_Fmt::Value())>(format);
+        (void)std::initializer_list<int>{([&content, &args]() {
+            constexpr auto span = spec.spans[_Idx];
+            content.append((format + span.begin), span.length);
+            if constexpr (span.arg_idx >= 0) {
+                _Append_Arg(content, std::get<span.arg_idx>(args), span.max_length);
+            }
+        }(), 0)...};
+        (void)args;
+    }
+
+    template <typename _Fmt, typename _Out, typename... _Args>
+    inline void _Format_Literal_To(_Out &content, const _Args &...args)
+    {
+        static constexpr auto spec = _Parse_Format<std::char_traits<char>::length(_Fmt::Value())>(_Fmt::Value());
+        static_assert(spec.valid, "Invalid format rule.");
+        static_assert(spec.arg_count == static_cast<int>(sizeof...(_Args)), "Format arguments do not match the placeholders.");
+
+        _Format_Spans<_Fmt>(content, std::forward_as_tuple(args...), std::make_index_sequence<spec.count>());
+    }
+
+    template <typename _Fmt>
+    using _Enable_If_Literal = typename std::enable_if<std::is_base_of<_Format_Literal_Tag, _Fmt>::value>::type;
+
+    // Parsed at compile time, mismatched placeholders and arguments do not build.
+    template <typename _Fmt, typename... _Args, typename = _Enable_If_Literal<_Fmt>>
+    inline std::string Format(_Fmt, const _Args &...args)
+    {
+        static constexpr auto spec = _Parse_Format<std::char_traits<char>::length(_Fmt::Value())>(_Fmt::Value());
+
+        std::string content{};
+        content.reserve(spec.literal_length + sizeof...(_Args) * 8);
+        _Format_Literal_To<_Fmt>(content, args...);
+        return content;
+    }
+
+    // Appends to content, reusing its capacity. Returns the number of characters appended.
+    template <typename _Fmt, typename... _Args, typename = _Enable_If_Literal<_Fmt>>
+    inline size_t FormatTo(std::string &content, _Fmt, const _Args &...args)
+    {
+        auto length = content.size();
+        _Format_Literal_To<_Fmt>(content, args...);
+        return (content.size() - length);
+    }
+
+    // Writes into buffer, never allocates. Returns the length written, excluding the terminating NUL.
+    template <typename _Fmt, typename... _Args, typename = _Enable_If_Literal<_Fmt>>
+    inline size_t FormatTo(char* buffer, size_t size, _Fmt, const _Args &...args)
+    {
+        if (size == 0) {
+            return 0;
+        }
+        _Format_Buffer content{buffer, size, 0};
+        buffer[0] = '\0';
+        _Format_Literal_To<_Fmt>(content, args...);
+        return content.length;
+    }
+
+    template <size_t _Size, typename _Fmt, typename... _Args, typename = _Enable_If_Literal<_Fmt>>
+    inline size_t FormatTo(char (&buffer)[_Size], _Fmt format, const _Args &...args)
+    {
+        return FormatTo(static_cast<char*>(buffer), _Size, format, args...);
+    }
+
     template <typename... _Args>
     inline int Println(const char* format, const _Args &...args) 
     {
@@ -43,7 +43,8 @@ CU::JSONItem::JSONItem(const _JSON_String &raw) : type_(), value_()
 		case '8':
 		case '9':
 			{
-				auto num = std::strtod(raw_data, nullptr);
+				double num = 0;
+				CU::ParseDouble(std::string_view(raw_data, len), num);
 				if (num != 0) {
 					if (num == static_cast<int64_t>(num)) {
 						if (num > static_cast<double>(INT_MAX) || num < static_cast<double>(INT_MIN)) {
@@ -396,11 +397,25 @@ std::string CU::JSONItem::toRaw() const
 			}
 			return "false";
 		case ItemType::INTEGER:
-			return std::to_string(std::get<int>(value_));
+			{
+				char buffer[CU::INT_CHARS_MAX] = { 0 };
+				return std::string(buffer, CU::IntToChars(buffer, std::get<int>(value_)));
+			}
 		case ItemType::LONG:
-			return std::to_string(std::get<int64_t>(value_));
+			{
+				char buffer[CU::INT_CHARS_MAX] = { 0 };
+				return std::string(buffer, CU::IntToChars(buffer, std::get<int64_t>(value_)));
+			}
 		case ItemType::DOUBLE:
-			return std::to_string(std::get<double>(value_));
+			{
+				char buffer[CU::DOUBLE_CHARS_MAX] = { 0 };
+				std::string raw(buffer, CU::DoubleToChars(buffer, std::get<double>(value_)));
+				// Keeps integral doubles reading back as doubles.
+				if (raw.find_first_of(".eE") == std::string::npos) {
+					raw += ".0";
+				}
+				return raw;
+			}
 		case ItemType::STRING:
 			return _JSON_Misc::StringToJSONRaw(std::get<std::string>(value_)).data();
 		case ItemType::ARRAY:
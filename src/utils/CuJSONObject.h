@@ -16,6 +16,7 @@
 #include <cstdint>
 #include <climits>
 #include <cstring>
+#include "CuCharConv.h"
 
 namespace CU
 {
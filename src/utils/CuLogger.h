@@ -1,5 +1,5 @@
 // CuLogger by chenzyadb.
-// Based on C++11 STL (GNUC) & CuFormat
+// Based on C++17 STL (GNUC) & CuFormat
 
 #if !defined(_CU_LOGGER_)
 #define _CU_LOGGER_ 1
@@ -14,48 +14,398 @@
 #include <thread>
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <tuple>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "CuFormat.h"
+#include "CuClock.h"
+#include "CuFlightRecorder.h"
+
+// Calls below this level compile to nothing, 0 (NONE) to 5 (VERBOSE).
+#if !defined(CU_LOG_MIN_LEVEL)
+#define CU_LOG_MIN_LEVEL 5
+#endif
 
 namespace CU
 {
+	// Short strings are copied inline, long ones (tombstones) go to the heap and are freed by the writer.
+	struct _Log_String
+	{
+		typedef std::string Stored;
+
+		static constexpr size_t INLINE_LENGTH = 46;
+		static constexpr size_t MAX_SIZE = sizeof(uint16_t) + INLINE_LENGTH;
+
+		static void EncodeChars(char* &pos, const char* value, size_t length)
+		{
+			if (length <= INLINE_LENGTH) {
+				auto inlineLength = static_cast<uint16_t>(length);
+				std::memcpy(pos, std::addressof(inlineLength), sizeof(uint16_t));
+				std::memcpy((pos + sizeof(uint16_t)), value, length);
+				pos += sizeof(uint16_t) + length;
+				return;
+			}
+			uint16_t heapMark = UINT16_MAX;
+			auto heapValue = new std::string(value, length);
+			std::memcpy(pos, std::addressof(heapMark), sizeof(uint16_t));
+			std::memcpy((pos + sizeof(uint16_t)), std::addressof(heapValue), sizeof(std::string*));
+			pos += sizeof(uint16_t) + sizeof(std::string*);
+		}
+
+		static void Encode(char* &pos, const std::string &value)
+		{
+			EncodeChars(pos, value.data(), value.size());
+		}
+
+		static void Encode(char* &pos, const char* value)
+		{
+			if (value == nullptr) {
+				value = "NULL";
+			}
+			EncodeChars(pos, value, std::strlen(value));
+		}
+
+		static Stored Decode(const char* &pos)
+		{
+			uint16_t length = 0;
+			std::memcpy(std::addressof(length), pos, sizeof(uint16_t));
+			pos += sizeof(uint16_t);
+			if (length == UINT16_MAX) {
+				std::string* heapValue = nullptr;
+				std::memcpy(std::addressof(heapValue), pos, sizeof(std::string*));
+				pos += sizeof(std::string*);
+				std::string value(std::move(*heapValue));
+				delete heapValue;
+				return value;
+			}
+			std::string value(pos, length);
+			pos += length;
+			return value;
+		}
+	};
+
+	// Arguments are copied into the log entry and formatted later on the writer thread.
+	// Trivially copyable values are stored as is, strings by content, anything else is formatted up front.
+	template <typename _Ty, typename = void>
+	struct _Log_Arg : public _Log_String
+	{
+		static void Encode(char* &pos, const _Ty &value)
+		{
+			_Log_String::Encode(pos, CU::Format("{}", value));
+		}
+	};
+
+	template <>
+	struct _Log_Arg<std::string> : public _Log_String { };
+
+	template <>
+	struct _Log_Arg<const char*> : public _Log_String { };
+
+	template <>
+	struct _Log_Arg<char*> : public _Log_String { };
+
+	template <size_t _Len>
+	struct _Log_Arg<char[_Len]> : public _Log_String { };
+
+	template <typename _Ty>
+	struct _Log_Arg<_Ty, typename std::enable_if<std::is_trivially_copyable<_Ty>::value && !std::is_array<_Ty>::value>::type>
+	{
+		typedef _Ty Stored;
+
+		static constexpr size_t MAX_SIZE = sizeof(_Ty);
+
+		static void Encode(char* &pos, const _Ty &value)
+		{
+			std::memcpy(pos, std::addressof(value), sizeof(_Ty));
+			pos += sizeof(_Ty);
+		}
+
+		static Stored Decode(const char* &pos)
+		{
+			_Ty value{};
+			std::memcpy(std::addressof(value), pos, sizeof(_Ty));
+			pos += sizeof(_Ty);
+			return value;
+		}
+	};
+
+	// Size-capped log file written through a mapped segment that is preallocated ahead of the data.
+	// The mapping outlives a crash in the page cache, zero padding past the last line is trimmed on open.
+	class _Log_File
+	{
+		public:
+			static constexpr size_t SEGMENT_SIZE = 64 * 1024;
+
+			_Log_File(const std::string &path, size_t maxSize, size_t fileCount) : 
+				path_(path), 
+				maxSize_(std::max(maxSize, SEGMENT_SIZE)), 
+				fileCount_(std::max(fileCount, static_cast<size_t>(1))), 
+				fd_(-1), 
+				map_(nullptr), 
+				mapOffset_(0), 
+				length_(0), 
+				syncedLength_(0) 
+			{ }
+
+			~_Log_File()
+			{
+				close_();
+			}
+
+			_Log_File(_Log_File &) = delete;
+			_Log_File &operator=(_Log_File &) = delete;
+
+			bool write(const char* data, size_t size)
+			{
+				if (fd_ < 0 && !open_(false)) {
+					return false;
+				}
+				if (length_ > 0 && (length_ + size) > maxSize_) {
+					rotate_();
+					if (!open_(true)) {
+						return false;
+					}
+				}
+				while (size > 0) {
+					if (length_ == (mapOffset_ + SEGMENT_SIZE) && !mapSegment_(length_)) {
+						return false;
+					}
+					auto copySize = std::min(size, (mapOffset_ + SEGMENT_SIZE - length_));
+					std::memcpy((map_ + (length_ - mapOffset_)), data, copySize);
+					length_ += copySize;
+					data += copySize;
+					size -= copySize;
+				}
+				return true;
+			}
+
+			bool dirty() const
+			{
+				return (length_ != syncedLength_);
+			}
+
+			void sync()
+			{
+				if (map_ == nullptr || !dirty()) {
+					return;
+				}
+				static const size_t pageSize = sysconf(_SC_PAGESIZE);
+				auto begin = std::max(syncedLength_, mapOffset_) - mapOffset_;
+				begin -= begin % pageSize;
+				msync((map_ + begin), (length_ - mapOffset_ - begin), MS_SYNC);
+				syncedLength_ = length_;
+			}
+
+		private:
+			const std::string path_;
+			const size_t maxSize_;
+			const size_t fileCount_;
+			int fd_;
+			char* map_;
+			size_t mapOffset_;
+			size_t length_;
+			size_t syncedLength_;
+
+			bool open_(bool truncate)
+			{
+				fd_ = ::open(path_.c_str(), (O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0)), 0644);
+				if (fd_ < 0) {
+					return false;
+				}
+				length_ = dataLength_();
+				ftruncate(fd_, length_);
+				syncedLength_ = length_;
+				return mapSegment_(length_ - (length_ % SEGMENT_SIZE));
+			}
+
+			// Another process or a crashed run may have left its preallocated tail behind.
+			size_t dataLength_()
+			{
+				struct stat fileStat{};
+				if (fstat(fd_, std::addressof(fileStat)) != 0) {
+					return 0;
+				}
+				auto end = static_cast<size_t>(fileStat.st_size);
+				char buffer[4096];
+				while (end > 0) {
+					auto begin = (end > sizeof(buffer)) ? (end - sizeof(buffer)) : 0;
+					auto len = pread(fd_, buffer, (end - begin), begin);
+					if (len != static_cast<ssize_t>(end - begin)) {
+						return end;
+					}
+					for (auto idx = len; idx > 0; idx--) {
+						if (buffer[idx - 1] != '\0') {
+							return (begin + idx);
+						}
+					}
+					end = begin;
+				}
+				return 0;
+			}
+
+			bool mapSegment_(size_t offset)
+			{
+				unmap_();
+				if (ftruncate(fd_, (offset + SEGMENT_SIZE)) != 0) {
+					return false;
+				}
+				auto map = mmap(nullptr, SEGMENT_SIZE, (PROT_READ | PROT_WRITE), MAP_SHARED, fd_, offset);
+				if (map == MAP_FAILED) {
+					return false;
+				}
+				map_ = static_cast<char*>(map);
+				mapOffset_ = offset;
+				return true;
+			}
+
+			void unmap_()
+			{
+				if (map_ != nullptr) {
+					sync();
+					munmap(map_, SEGMENT_SIZE);
+					map_ = nullptr;
+				}
+			}
+
+			void close_()
+			{
+				if (fd_ >= 0) {
+					unmap_();
+					ftruncate(fd_, length_);
+					::close(fd_);
+					fd_ = -1;
+				}
+			}
+
+			// log.txt -> log.txt.1 -> ... -> log.txt.(fileCount - 1), the oldest one is overwritten.
+			void rotate_()
+			{
+				close_();
+				for (auto idx = (fileCount_ - 1); idx > 0; idx--) {
+					auto from = (idx == 1) ? path_ : CU::Format("{}.{}", path_, (idx - 1));
+					std::rename(from.c_str(), CU::Format("{}.{}", path_, idx).c_str());
+				}
+			}
+	};
+
+	// "MM-DD HH:MM:SS.mmm", localtime only runs when the second changes.
+	class _Log_TimePrefix
+	{
+		public:
+			static constexpr size_t SECOND_LENGTH = 14;
+
+			_Log_TimePrefix() : second_(INT64_MIN), prefix_() { }
+
+			void append(std::string &line, int64_t wallNs)
+			{
+				auto second = wallNs / 1000000000LL;
+				if (second != second_) {
+					auto nowTime = static_cast<time_t>(second);
+					struct tm localTime{};
+					localtime_r(std::addressof(nowTime), std::addressof(localTime));
+					std::snprintf(prefix_, sizeof(prefix_), "%02d-%02d %02d:%02d:%02d",
+						localTime.tm_mon + 1, localTime.tm_mday, localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+					second_ = second;
+				}
+				auto ms = static_cast<int>((wallNs % 1000000000LL) / 1000000LL);
+				char millis[4] = {'.', static_cast<char>('0' + ms / 100), static_cast<char>('0' + ms / 10 % 10), static_cast<char>('0' + ms % 10)};
+				line.append(prefix_, SECOND_LENGTH);
+				line.append(millis, sizeof(millis));
+			}
+
+		private:
+			int64_t second_;
+			char prefix_[32];
+	};
+
 	class Logger
 	{
 		public:
 			enum class LogLevel : uint8_t {NONE, ERROR, WARN, INFO, DEBUG, VERBOSE};
+			// What a full ring does to the calling thread, errors always wait for room.
+			enum class OverflowPolicy : uint8_t {DROP, BLOCK};
+
+			// False for levels below CU_LOG_MIN_LEVEL, their calls are compiled out.
+			static constexpr bool IsCompiled(const LogLevel &level)
+			{
+				return (static_cast<int>(level) <= CU_LOG_MIN_LEVEL);
+			}
 
 			static void Create(const LogLevel &level, const std::string &path)
 			{
 				Instance_().setLogger_(level, path);
 			}
 
+			// Must be called before Create, log.txt is rotated to log.txt.1 once it would exceed maxSize.
+			static void SetRotation(size_t maxSize, size_t fileCount)
+			{
+				Instance_().maxSize_ = maxSize;
+				Instance_().fileCount_ = fileCount;
+			}
+
+			static void SetOverflowPolicy(const OverflowPolicy &policy)
+			{
+				Instance_().overflowPolicy_.store(policy, std::memory_order_relaxed);
+			}
+
+			static uint64_t DroppedCount()
+			{
+				return Instance_().dropped_.load(std::memory_order_relaxed);
+			}
+
+			// Guards arguments that are expensive to compute, the log calls check the level themselves.
+			static bool IsLoggable(const LogLevel &level)
+			{
+				return (IsCompiled(level) && level <= Instance_().logLevel_.load(std::memory_order_relaxed));
+			}
+
 			template <typename ..._Args>
 			static void Error(const char* format, const _Args &...args)
 			{
-				Instance_().joinLogQueue_(LogLevel::ERROR, CU::Format(format, args...));
+				if constexpr (IsCompiled(LogLevel::ERROR)) {
+					Instance_().joinLogQueue_(LogLevel::ERROR, format, args...);
+				}
 			}
 
 			template <typename ..._Args>
 			static void Warn(const char* format, const _Args &...args)
 			{
-				Instance_().joinLogQueue_(LogLevel::WARN, CU::Format(format, args...));
+				if constexpr (IsCompiled(LogLevel::WARN)) {
+					Instance_().joinLogQueue_(LogLevel::WARN, format, args...);
+				}
 			}
 
 			template <typename ..._Args>
 			static void Info(const char* format, const _Args &...args)
 			{
-				Instance_().joinLogQueue_(LogLevel::INFO, CU::Format(format, args...));
+				if constexpr (IsCompiled(LogLevel::INFO)) {
+					Instance_().joinLogQueue_(LogLevel::INFO, format, args...);
+				}
 			}
 
 			template <typename ..._Args>
 			static void Debug(const char* format, const _Args &...args)
 			{
-				Instance_().joinLogQueue_(LogLevel::DEBUG, CU::Format(format, args...));
+				if constexpr (IsCompiled(LogLevel::DEBUG)) {
+					Instance_().joinLogQueue_(LogLevel::DEBUG, format, args...);
+				}
 			}
 
 			template <typename ..._Args>
 			static void Verbose(const char* format, const _Args &...args)
 			{
-				Instance_().joinLogQueue_(LogLevel::VERBOSE, CU::Format(format, args...));
+				if constexpr (IsCompiled(LogLevel::VERBOSE)) {
+					Instance_().joinLogQueue_(LogLevel::VERBOSE, format, args...);
+				}
 			}
 
 			static void Flush()
@@ -64,14 +414,75 @@ namespace CU
 			}
 
 		private:
-			Logger() : logPath_(), logLevel_(), cv_(), mtx_(), logQueue_(), queueFlushed_(true) { }
+			static constexpr size_t RING_SIZE = 512;
+			static constexpr size_t PAYLOAD_SIZE = 216;
+			static constexpr size_t DEFAULT_MAX_SIZE = 4 * 1024 * 1024;
+			static constexpr size_t DEFAULT_FILE_COUNT = 2;
+			static constexpr int64_t SYNC_INTERVAL_NS = 1000000000LL;
+
+			typedef std::string (*Formatter)(const char* format, const char* payload);
+
+			struct alignas(64) LogEntry
+			{
+				std::atomic<size_t> sequence;
+				LogLevel level;
+				int64_t timestamp;
+				const char* format;
+				Formatter formatter;
+				char payload[PAYLOAD_SIZE];
+			};
+			static_assert(sizeof(LogEntry) == 256, "LogEntry should fill four cache lines.");
+
+			Logger() : 
+				logPath_(), 
+				maxSize_(DEFAULT_MAX_SIZE), 
+				fileCount_(DEFAULT_FILE_COUNT), 
+				logLevel_(LogLevel::NONE), 
+				overflowPolicy_(OverflowPolicy::DROP), 
+				ring_(new LogEntry[RING_SIZE]), 
+				enqueuePos_(0), 
+				dequeuePos_(0), 
+				dropped_(0), 
+				syncRequests_(0), 
+				syncedRequests_(0), 
+				running_(false), 
+				sleeping_(false), 
+				cv_(), 
+				mtx_() 
+			{
+				for (size_t idx = 0; idx < RING_SIZE; idx++) {
+					ring_[idx].sequence.store(idx, std::memory_order_relaxed);
+				}
+			}
+
 			Logger(Logger &) = delete;
 			Logger &operator=(Logger &) = delete;
 
 			static Logger &Instance_()
 			{
-				static Logger instance{};
-				return instance;
+				// Never destroyed, the detached writer may still be touching the ring at exit.
+				static Logger* instance = new Logger();
+				return *instance;
+			}
+
+			template <typename ..._Args>
+			static constexpr size_t PayloadSize_()
+			{
+				size_t size = 0;
+				(void)std::initializer_list<int>{(size += _Log_Arg<_Args>::MAX_SIZE, 0)...};
+				return size;
+			}
+
+			template <typename ..._Args>
+			static std::string Format_(const char* format, const char* payload)
+			{
+				auto pos = payload;
+				// Braced initialization decodes the arguments left to right.
+				std::tuple<typename _Log_Arg<_Args>::Stored...> args{_Log_Arg<_Args>::Decode(pos)...};
+				(void)pos;
+				return std::apply([format](const auto &...values) -> std::string {
+					return CU::Format(format, values...);
+				}, args);
 			}
 
 			void setLogger_(const LogLevel &level, const std::string &path)
@@ -85,98 +496,187 @@ namespace CU
 					return false;
 				};
 
-				if (logLevel_ == LogLevel::NONE && level != LogLevel::NONE) {
-					logLevel_ = level;
+				if (logLevel_.load() == LogLevel::NONE && level != LogLevel::NONE) {
 					logPath_ = path;
 					if (createFile(logPath_)) {
+						running_ = true;
 						std::thread mainLoop(std::bind(&Logger::mainLoop_, this));
 						mainLoop.detach();
 					}
+					logLevel_.store(level);
 				}
 			}
 
 			void mainLoop_()
 			{
-				auto fp = std::fopen(logPath_.c_str(), "at");
-				if (fp == nullptr) {
-					return;
-				}
-				std::vector<std::string> writeQueue{};
-				for (;;) {
-					{
-						std::unique_lock<std::mutex> lck(mtx_);
-						queueFlushed_ = logQueue_.empty();
-						while (logQueue_.empty()) {
-							cv_.wait(lck);
+				static const auto levelTag = [](LogLevel level) -> const char* {
+					switch (level) {
+						case LogLevel::ERROR:
+							return " [E] ";
+						case LogLevel::WARN:
+							return " [W] ";
+						case LogLevel::INFO:
+							return " [I] ";
+						case LogLevel::DEBUG:
+							return " [D] ";
+						default:
+							break;
+					}
+					return " [V] ";
+				};
+
+				// Opened on the first write, so the watchdog does not hold the file while the daemon logs.
+				_Log_File logFile(logPath_, maxSize_, fileCount_);
+				const auto writeLine = [this, &logFile](const std::string &line) {
+					if (!logFile.write(line.data(), line.size())) {
+						running_ = false;
+					}
+				};
+				_Log_TimePrefix timePrefix{};
+				std::string line{};
+				uint64_t reportedDrops = 0;
+				int64_t lastSyncTime = 0;
+				while (running_) {
+					size_t count = 0;
+					// Read before draining, so every entry logged ahead of a Flush() is part of this pass.
+					auto syncRequests = syncRequests_.load();
+					bool syncNow = (syncRequests != syncedRequests_.load(std::memory_order_relaxed));
+					// Entries carry the monotonic time they were logged at, mapped to wall time once per batch.
+					auto wallOffset = CU::Clock::Default()->realtimeNs() - CU::Clock::Default()->monotonicNs();
+					for (;;) {
+						auto &entry = ring_[dequeuePos_ & (RING_SIZE - 1)];
+						if (entry.sequence.load(std::memory_order_acquire) != (dequeuePos_ + 1)) {
+							break;
+						}
+						line.clear();
+						timePrefix.append(line, (entry.timestamp + wallOffset));
+						line += levelTag(entry.level);
+						try {
+							line += entry.formatter(entry.format, entry.payload);
+						} catch (const std::exception &e) {
+							line += entry.format;
 						}
-						writeQueue = logQueue_;
-						logQueue_.clear();
+						line += '\n';
+						syncNow |= (entry.level == LogLevel::ERROR);
+						entry.sequence.store((dequeuePos_ + RING_SIZE), std::memory_order_release);
+						dequeuePos_++;
+						writeLine(line);
+						count++;
+					}
+					auto dropped = dropped_.load(std::memory_order_relaxed);
+					if (dropped != reportedDrops) {
+						line.clear();
+						timePrefix.append(line, (CU::Clock::Default()->monotonicNs() + wallOffset));
+						line += " [W] ";
+						line += CU::Format("{} log entries dropped.\n", (dropped - reportedDrops));
+						writeLine(line);
+						reportedDrops = dropped;
+						count++;
+					}
+					// Errors and Flush() go to storage right away, everything else at most once per interval.
+					auto now = CU::Clock::Coarse()->monotonicNs();
+					if (syncNow || (logFile.dirty() && (now - lastSyncTime) >= SYNC_INTERVAL_NS)) {
+						logFile.sync();
+						lastSyncTime = now;
+					}
+					syncedRequests_.store(syncRequests, std::memory_order_release);
+					if (count > 0) {
+						continue;
+					}
+					// Producers only pay for a wakeup when the writer announced it is going to sleep.
+					sleeping_.store(true);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (ring_[dequeuePos_ & (RING_SIZE - 1)].sequence.load(std::memory_order_acquire) == (dequeuePos_ + 1)) {
+						sleeping_.store(false);
+						continue;
 					}
-					if (!writeQueue.empty()) {
-						for (const auto &log : writeQueue) {
-							std::fputs(log.c_str(), fp);
+					std::unique_lock<std::mutex> lck(mtx_);
+					while (sleeping_.load()) {
+						if (!logFile.dirty()) {
+							cv_.wait(lck);
+						} else if (cv_.wait_for(lck, std::chrono::nanoseconds(SYNC_INTERVAL_NS)) == std::cv_status::timeout) {
+							sleeping_.store(false);
 						}
-						std::fflush(fp);
-						writeQueue.clear();
 					}
 				}
 			}
 
-			void joinLogQueue_(const LogLevel &level, const std::string &content)
+			void wakeWriter_()
 			{
-				static const auto getTimeInfo = []() -> std::string {
-					auto now = std::chrono::system_clock::now();
-					auto nowTime = std::chrono::system_clock::to_time_t(now);
-					auto localTime = std::localtime(std::addressof(nowTime));
-					char buffer[16] = { 0 };
-					std::snprintf(buffer, sizeof(buffer), "%02d-%02d %02d:%02d:%02d",
-						localTime->tm_mon + 1, localTime->tm_mday, localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
-					return buffer;
-				};
-
 				std::unique_lock<std::mutex> lck(mtx_);
-				if (level <= logLevel_) {
-					switch (level) {
-						case LogLevel::ERROR:
-							logQueue_.emplace_back(getTimeInfo() + " [E] " + content + '\n');
-							break;
-						case LogLevel::WARN:
-							logQueue_.emplace_back(getTimeInfo() + " [W] " + content + '\n');
-							break;
-						case LogLevel::INFO:
-							logQueue_.emplace_back(getTimeInfo() + " [I] " + content + '\n');
-							break;
-						case LogLevel::DEBUG:
-							logQueue_.emplace_back(getTimeInfo() + " [D] " + content + '\n');
-							break;
-						case LogLevel::VERBOSE:
-							logQueue_.emplace_back(getTimeInfo() + " [V] " + content + '\n');
-							break;
-						default:
+				sleeping_.store(false);
+				cv_.notify_one();
+			}
+
+			template <typename ..._Args>
+			void joinLogQueue_(const LogLevel &level, const char* format, const _Args &...args)
+			{
+				static_assert(PayloadSize_<_Args...>() <= PAYLOAD_SIZE, "Too many log arguments.");
+				if (level > logLevel_.load(std::memory_order_relaxed)) {
+					return;
+				}
+				CU::FlightRecorder::RecordLog(" EWIDV"[static_cast<int>(level)], format);
+				auto pos = enqueuePos_.load(std::memory_order_relaxed);
+				LogEntry* entry = nullptr;
+				for (;;) {
+					entry = std::addressof(ring_[pos & (RING_SIZE - 1)]);
+					auto diff = static_cast<intptr_t>(entry->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+					if (diff == 0) {
+						if (enqueuePos_.compare_exchange_weak(pos, (pos + 1), std::memory_order_relaxed)) {
 							break;
+						}
+					} else if (diff < 0) {
+						if (!running_ || (level != LogLevel::ERROR && overflowPolicy_.load(std::memory_order_relaxed) == OverflowPolicy::DROP)) {
+							dropped_.fetch_add(1, std::memory_order_relaxed);
+							return;
+						}
+						std::this_thread::yield();
+						pos = enqueuePos_.load(std::memory_order_relaxed);
+					} else {
+						pos = enqueuePos_.load(std::memory_order_relaxed);
 					}
-					cv_.notify_all();
+				}
+				entry->level = level;
+				entry->timestamp = CU::Clock::Default()->monotonicNs();
+				entry->format = format;
+				entry->formatter = std::addressof(Format_<_Args...>);
+				char* payloadPos = entry->payload;
+				(void)std::initializer_list<int>{(_Log_Arg<_Args>::Encode(payloadPos, args), 0)...};
+				(void)payloadPos;
+				entry->sequence.store((pos + 1), std::memory_order_release);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (sleeping_.load(std::memory_order_relaxed)) {
+					wakeWriter_();
 				}
 			}
 
 			void flushLogQueue_()
 			{
-				bool flushed = false;
-				while (!flushed) {
-					{
-						std::unique_lock<std::mutex> lck(mtx_);
-						flushed = queueFlushed_;
-					}
-					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				if (!running_) {
+					return;
+				}
+				auto request = syncRequests_.fetch_add(1) + 1;
+				while (syncedRequests_.load(std::memory_order_acquire) < request && running_) {
+					wakeWriter_();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
 				}
 			}
 
 			std::string logPath_;
-			LogLevel logLevel_;
+			size_t maxSize_;
+			size_t fileCount_;
+			std::atomic<LogLevel> logLevel_;
+			std::atomic<OverflowPolicy> overflowPolicy_;
+			std::unique_ptr<LogEntry[]> ring_;
+			std::atomic<size_t> enqueuePos_;
+			size_t dequeuePos_;
+			std::atomic<uint64_t> dropped_;
+			std::atomic<uint64_t> syncRequests_;
+			std::atomic<uint64_t> syncedRequests_;
+			volatile bool running_;
+			std::atomic<bool> sleeping_;
 			std::condition_variable cv_;
 			std::mutex mtx_;
-			std::vector<std::string> logQueue_;
-			volatile bool queueFlushed_;
 		};
 }
 
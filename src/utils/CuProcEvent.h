@@ -0,0 +1,188 @@
+// CuProcEvent by chenzyadb@github.com
+// Based on C++11 STL (LLVM)
+
+#ifndef _CU_PROC_EVENT_
+#define _CU_PROC_EVENT_
+
+#if defined(__linux__) && defined(__GNUC__)
+
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#define CU_INLINE __attribute__((always_inline)) inline
+#define CU_LIKELY(val) (__builtin_expect(!!(val), 1))
+#define CU_UNLIKELY(val) (__builtin_expect(!!(val), 0))
+#define CU_MEMSET(dst, ch, size) __builtin_memset(dst, ch, size)
+#define CU_MEMCPY(dst, src, size) __builtin_memcpy(dst, src, size)
+
+namespace CU
+{
+    // Process lifecycle events from the kernel proc connector (CONFIG_PROC_EVENTS).
+    // Requires CAP_NET_ADMIN, only process-level (pid == tgid) events are reported.
+    class ProcEventConnector
+    {
+        public:
+            enum class EventType : uint8_t {NONE, FORK, EXEC, COMM, EXIT, OVERRUN};
+
+            struct Event
+            {
+                EventType type;
+                int pid;
+                int parentPid;
+                int exitCode;
+                char comm[16];
+            };
+
+            CU_INLINE ProcEventConnector() noexcept : sockFd_(-1) { }
+
+            ProcEventConnector(const ProcEventConnector &other) = delete;
+            ProcEventConnector &operator=(const ProcEventConnector &other) = delete;
+
+            CU_INLINE ~ProcEventConnector() noexcept
+            {
+                close();
+            }
+
+            // A non-blocking connector is meant to be polled, wait() then fails with EAGAIN once drained.
+            CU_INLINE bool open(bool nonBlock = false) noexcept
+            {
+                if (sockFd_ >= 0) {
+                    return true;
+                }
+                int sockType = nonBlock ? (SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK) : (SOCK_DGRAM | SOCK_CLOEXEC);
+                sockFd_ = socket(PF_NETLINK, sockType, NETLINK_CONNECTOR);
+                if (CU_UNLIKELY(sockFd_ < 0)) {
+                    return false;
+                }
+                struct sockaddr_nl addr{};
+                addr.nl_family = AF_NETLINK;
+                addr.nl_groups = CN_IDX_PROC;
+                addr.nl_pid = 0;
+                if (bind(sockFd_, reinterpret_cast<struct sockaddr*>(std::addressof(addr)), sizeof(addr)) < 0 ||
+                    !setListen_(PROC_CN_MCAST_LISTEN))
+                {
+                    close();
+                    return false;
+                }
+                return true;
+            }
+
+            CU_INLINE void close() noexcept
+            {
+                if (sockFd_ >= 0) {
+                    setListen_(PROC_CN_MCAST_IGNORE);
+                    ::close(sockFd_);
+                    sockFd_ = -1;
+                }
+            }
+
+            // Blocks until the next process-level event, returns false if the socket is broken
+            // or, in non-blocking mode, with errno set to EAGAIN when no event is pending.
+            CU_INLINE bool wait(Event &event) noexcept
+            {
+                alignas(struct nlmsghdr) char buffer[1024];
+                for (;;) {
+                    auto len = recv(sockFd_, buffer, sizeof(buffer), 0);
+                    if (CU_UNLIKELY(len < 0)) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        if (errno == ENOBUFS) {
+                            CU_MEMSET(std::addressof(event), 0, sizeof(Event));
+                            event.type = EventType::OVERRUN;
+                            return true;
+                        }
+                        return false;
+                    }
+                    if (CU_UNLIKELY(len == 0)) {
+                        return false;
+                    }
+                    auto nlh = reinterpret_cast<struct nlmsghdr*>(buffer);
+                    for (; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+                        if (nlh->nlmsg_type == NLMSG_NOOP || nlh->nlmsg_type == NLMSG_ERROR) {
+                            continue;
+                        }
+                        auto cnMsg = reinterpret_cast<struct cn_msg*>(NLMSG_DATA(nlh));
+                        if (cnMsg->id.idx != CN_IDX_PROC || cnMsg->id.val != CN_VAL_PROC) {
+                            continue;
+                        }
+                        if (parseEvent_(reinterpret_cast<const struct proc_event*>(cnMsg->data), event)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+
+            CU_INLINE int fd() const noexcept
+            {
+                return sockFd_;
+            }
+
+        private:
+            int sockFd_;
+
+            CU_INLINE bool setListen_(enum proc_cn_mcast_op op) noexcept
+            {
+                alignas(struct nlmsghdr) char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))] = { 0 };
+                auto nlh = reinterpret_cast<struct nlmsghdr*>(buffer);
+                nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+                nlh->nlmsg_type = NLMSG_DONE;
+                nlh->nlmsg_pid = getpid();
+                auto cnMsg = reinterpret_cast<struct cn_msg*>(NLMSG_DATA(nlh));
+                cnMsg->id.idx = CN_IDX_PROC;
+                cnMsg->id.val = CN_VAL_PROC;
+                cnMsg->len = sizeof(op);
+                CU_MEMCPY(cnMsg->data, std::addressof(op), sizeof(op));
+                return (send(sockFd_, nlh, nlh->nlmsg_len, 0) == static_cast<ssize_t>(nlh->nlmsg_len));
+            }
+
+            CU_INLINE bool parseEvent_(const struct proc_event* procEvent, Event &event) noexcept
+            {
+                CU_MEMSET(std::addressof(event), 0, sizeof(Event));
+                switch (procEvent->what) {
+                    case proc_event::PROC_EVENT_FORK:
+                        if (procEvent->event_data.fork.child_pid != procEvent->event_data.fork.child_tgid) {
+                            return false;
+                        }
+                        event.type = EventType::FORK;
+                        event.pid = procEvent->event_data.fork.child_pid;
+                        event.parentPid = procEvent->event_data.fork.parent_tgid;
+                        return true;
+                    case proc_event::PROC_EVENT_EXEC:
+                        event.type = EventType::EXEC;
+                        event.pid = procEvent->event_data.exec.process_tgid;
+                        return true;
+                    case proc_event::PROC_EVENT_COMM:
+                        if (procEvent->event_data.comm.process_pid != procEvent->event_data.comm.process_tgid) {
+                            return false;
+                        }
+                        event.type = EventType::COMM;
+                        event.pid = procEvent->event_data.comm.process_tgid;
+                        CU_MEMCPY(event.comm, procEvent->event_data.comm.comm, sizeof(event.comm));
+                        event.comm[sizeof(event.comm) - 1] = '\0';
+                        return true;
+                    case proc_event::PROC_EVENT_EXIT:
+                        if (procEvent->event_data.exit.process_pid != procEvent->event_data.exit.process_tgid) {
+                            return false;
+                        }
+                        event.type = EventType::EXIT;
+                        event.pid = procEvent->event_data.exit.process_tgid;
+                        event.exitCode = static_cast<int>(procEvent->event_data.exit.exit_code);
+                        return true;
+                    default:
+                        break;
+                }
+                return false;
+            }
+    };
+}
+
+#endif // __linux__ && __GNUC__
+#endif // _CU_PROC_EVENT_
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
 
 namespace CU
 {
@@ -72,4 +77,190 @@ namespace CU
             _Ty val_;
             mutable std::mutex mtx_;
     };
+
+    // Read-mostly value, readers pin the current version through a guard without copying it or
+    // taking a lock. Writers publish a new version and wait for the readers of the old one (SRCU-style
+    // grace period over two epochs of per-thread-striped counters) before freeing it.
+    template <typename _Ty>
+    class ReadMostlyVal
+    {
+        public:
+            class Guard
+            {
+                public:
+                    Guard(const ReadMostlyVal* owner) : counter_(owner->Lock_()), val_(owner->current_.load()) { }
+
+                    Guard(const Guard &other) = delete;
+                    Guard &operator=(const Guard &other) = delete;
+
+                    ~Guard()
+                    {
+                        counter_->fetch_sub(1, std::memory_order_release);
+                    }
+
+                    const _Ty &operator*() const
+                    {
+                        return *val_;
+                    }
+
+                    const _Ty* operator->() const
+                    {
+                        return val_;
+                    }
+
+                private:
+                    std::atomic<int64_t>* counter_;
+                    const _Ty* val_;
+            };
+
+            ReadMostlyVal() : current_(new _Ty()), epoch_(0), readers_(), writeMtx_() { }
+
+            ReadMostlyVal(const _Ty &val) : current_(new _Ty(val)), epoch_(0), readers_(), writeMtx_() { }
+
+            ReadMostlyVal(const ReadMostlyVal &other) = delete;
+            ReadMostlyVal &operator=(const ReadMostlyVal &other) = delete;
+
+            ~ReadMostlyVal()
+            {
+                delete current_.load();
+            }
+
+            // The guard must not outlive the thread's use of the value, a writer waits for it.
+            Guard read() const
+            {
+                return Guard(this);
+            }
+
+            _Ty data() const
+            {
+                return *read();
+            }
+
+            void store(_Ty &&val)
+            {
+                Publish_(new _Ty(std::move(val)));
+            }
+
+            void store(const _Ty &val)
+            {
+                Publish_(new _Ty(val));
+            }
+
+            ReadMostlyVal &operator=(const _Ty &val)
+            {
+                store(val);
+                return *this;
+            }
+
+            ReadMostlyVal &operator=(_Ty &&val)
+            {
+                store(std::move(val));
+                return *this;
+            }
+
+        private:
+            static constexpr size_t READER_SLOTS = 16;
+
+            struct alignas(64) ReaderSlot
+            {
+                std::atomic<int64_t> count;
+            };
+
+            std::atomic<const _Ty*> current_;
+            std::atomic<uint32_t> epoch_;
+            mutable ReaderSlot readers_[2][READER_SLOTS];
+            std::mutex writeMtx_;
+
+            static size_t SlotIndex_()
+            {
+                static std::atomic<size_t> nextSlot{0};
+                thread_local size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % READER_SLOTS;
+                return slot;
+            }
+
+            std::atomic<int64_t>* Lock_() const
+            {
+                auto counter = std::addressof(readers_[epoch_.load() & 1][SlotIndex_()].count);
+                counter->fetch_add(1);
+                return counter;
+            }
+
+            void WaitReaders_(uint32_t epoch)
+            {
+                for (;;) {
+                    int64_t count = 0;
+                    for (const auto &slot : readers_[epoch & 1]) {
+                        count += slot.count.load();
+                    }
+                    if (count == 0) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+
+            void Publish_(const _Ty* val)
+            {
+                std::unique_lock<std::mutex> lock(writeMtx_);
+                auto prev = current_.exchange(val);
+                // Two flips: a reader that sampled the epoch just before a flip counts on the other side.
+                for (int flip = 0; flip < 2; flip++) {
+                    auto epoch = epoch_.fetch_add(1);
+                    WaitReaders_(epoch);
+                }
+                delete prev;
+            }
+    };
+
+    // Sequence-locked value for small trivially copyable types, readers copy and retry on a concurrent write.
+    template <typename _Ty>
+    class SeqLockVal
+    {
+        static_assert(std::is_trivially_copyable<_Ty>::value, "SeqLockVal needs a trivially copyable type.");
+
+        public:
+            SeqLockVal() : seq_(0), val_(), writeMtx_() { }
+
+            SeqLockVal(const _Ty &val) : seq_(0), val_(val), writeMtx_() { }
+
+            SeqLockVal(const SeqLockVal &other) = delete;
+            SeqLockVal &operator=(const SeqLockVal &other) = delete;
+
+            _Ty load() const
+            {
+                _Ty val{};
+                for (;;) {
+                    auto seq = seq_.load(std::memory_order_acquire);
+                    if ((seq & 1) == 0) {
+                        std::memcpy(std::addressof(val), std::addressof(val_), sizeof(_Ty));
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        if (seq_.load(std::memory_order_relaxed) == seq) {
+                            return val;
+                        }
+                    }
+                    std::this_thread::yield();
+                }
+            }
+
+            void store(const _Ty &val)
+            {
+                std::unique_lock<std::mutex> lock(writeMtx_);
+                auto seq = seq_.load(std::memory_order_relaxed);
+                seq_.store(seq + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                std::memcpy(std::addressof(val_), std::addressof(val), sizeof(_Ty));
+                seq_.store(seq + 2, std::memory_order_release);
+            }
+
+            SeqLockVal &operator=(const _Ty &val)
+            {
+                store(val);
+                return *this;
+            }
+
+        private:
+            std::atomic<uint64_t> seq_;
+            _Ty val_;
+            std::mutex writeMtx_;
+    };
 }
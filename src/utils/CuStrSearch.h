@@ -0,0 +1,257 @@
+// CuStrSearch by chenzyadb@github.com
+// Based on C++17 STL (LLVM)
+
+#ifndef _CU_STR_SEARCH_
+#define _CU_STR_SEARCH_
+
+#include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// One kernel set is compiled in: NEON on aarch64, AVX2 or SSE2 on x86_64, plain loops otherwise.
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define _CU_STR_SEARCH_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define _CU_STR_SEARCH_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define _CU_STR_SEARCH_SSE2 1
+#endif
+
+namespace CU
+{
+#if defined(_CU_STR_SEARCH_NEON)
+    typedef uint8x16_t _Search_Vec;
+    constexpr size_t _SEARCH_VEC_SIZE = 16;
+
+    inline _Search_Vec _Search_Load(const char* pos) noexcept
+    {
+        return vld1q_u8(reinterpret_cast<const uint8_t*>(pos));
+    }
+
+    inline _Search_Vec _Search_Splat(char ch) noexcept
+    {
+        return vdupq_n_u8(static_cast<uint8_t>(ch));
+    }
+
+    inline _Search_Vec _Search_Eq(_Search_Vec a, _Search_Vec b) noexcept
+    {
+        return vceqq_u8(a, b);
+    }
+
+    inline _Search_Vec _Search_And(_Search_Vec a, _Search_Vec b) noexcept
+    {
+        return vandq_u8(a, b);
+    }
+
+
+    // NEON has no movemask, narrowing leaves 4 bits per byte.
+    constexpr int _SEARCH_MASK_SHIFT = 2;
+
+    inline uint64_t _Search_Mask(_Search_Vec cmp) noexcept
+    {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+    }
+
+    // Clears the lowest match, which takes 4 bits.
+    inline uint64_t _Search_Mask_Next(uint64_t mask) noexcept
+    {
+        return (mask & ~(static_cast<uint64_t>(0xF) << (__builtin_ctzll(mask) & ~3)));
+    }
+#elif defined(_CU_STR_SEARCH_AVX2)
+    typedef __m256i _Search_Vec;
+    constexpr size_t _SEARCH_VEC_SIZE = 32;
+
+    inline _Search_Vec _Search_Load(const char* pos) noexcept
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    }
+
+    inline _Search_Vec _Search_Splat(char ch) noexcept
+    {
+        return _mm256_set1_epi8(ch);
+    }
+
+    inline _Search_Vec _Search_Eq(_Search_Vec a, _Search_Vec b) noexcept
+    {
+        return _mm256_cmpeq_epi8(a, b);
+    }
+
+    inline _Search_Vec _Search_And(_Search_Vec a, _Search_Vec b) noexcept
+    {
+        return _mm256_and_si256(a, b);
+    }
+
+
+    constexpr int _SEARCH_MASK_SHIFT = 0;
+
+    inline uint64_t _Search_Mask(_Search_Vec cmp) noexcept
+    {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(cmp));
+    }
+
+    inline uint64_t _Search_Mask_Next(uint64_t mask) noexcept
+    {
+        return (mask & (mask - 1));
+    }
+#elif defined(_CU_STR_SEARCH_SSE2)
+    typedef __m128i _Search_Vec;
+    constexpr size_t _SEARCH_VEC_SIZE = 16;
+
+    inline _Search_Vec _Search_Load(const char* pos) noexcept
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    }
+
+    inline _Search_Vec _Search_Splat(char ch) noexcept
+    {
+        return _mm_set1_epi8(ch);
+    }
+
+    inline _Search_Vec _Search_Eq(_Search_Vec a, _Search_Vec b) noexcept
+    {
+        return _mm_cmpeq_epi8(a, b);
+    }
+
+    inline _Search_Vec _Search_And(_Search_Vec a, _Search_Vec b) noexcept
+    {
+        return _mm_and_si128(a, b);
+    }
+
+
+    constexpr int _SEARCH_MASK_SHIFT = 0;
+
+    inline uint64_t _Search_Mask(_Search_Vec cmp) noexcept
+    {
+        return static_cast<uint32_t>(_mm_movemask_epi8(cmp));
+    }
+
+    inline uint64_t _Search_Mask_Next(uint64_t mask) noexcept
+    {
+        return (mask & (mask - 1));
+    }
+#endif
+
+    // First ch in [first, last), last if there is none.
+    // libc memchr is already vectorised on bionic and glibc and outran an unrolled loop here, so it is kept.
+    inline const char* FindChar(const char* first, const char* last, char ch) noexcept
+    {
+        auto pos = static_cast<const char*>(std::memchr(first, ch, static_cast<size_t>(last - first)));
+        return (pos != nullptr) ? pos : last;
+    }
+
+    // First occurrence of needle in [first, last), last if there is none. An empty needle is found at first.
+    inline const char* FindStr(const char* first, const char* last, const char* needle, size_t needleSize) noexcept
+    {
+        if (needleSize <= 1) {
+            return (needleSize == 0) ? first : FindChar(first, last, needle[0]);
+        }
+        if (static_cast<size_t>(last - first) < needleSize) {
+            return last;
+        }
+        // Candidates must match the first and the last needle byte, only those reach memcmp.
+        auto lastStart = last - needleSize;
+#if defined(_CU_STR_SEARCH_NEON) || defined(_CU_STR_SEARCH_AVX2) || defined(_CU_STR_SEARCH_SSE2)
+        auto firstByte = _Search_Splat(needle[0]);
+        auto lastByte = _Search_Splat(needle[needleSize - 1]);
+        for (; static_cast<size_t>(lastStart - first) >= _SEARCH_VEC_SIZE; first += _SEARCH_VEC_SIZE) {
+            auto match = _Search_And(_Search_Eq(_Search_Load(first), firstByte),
+                                     _Search_Eq(_Search_Load(first + needleSize - 1), lastByte));
+            auto mask = _Search_Mask(match);
+            while (mask != 0) {
+                auto candidate = first + (__builtin_ctzll(mask) >> _SEARCH_MASK_SHIFT);
+                if (std::memcmp((candidate + 1), (needle + 1), (needleSize - 2)) == 0) {
+                    return candidate;
+                }
+                mask = _Search_Mask_Next(mask);
+            }
+        }
+#endif
+        for (; first <= lastStart; first++) {
+            first = FindChar(first, (lastStart + 1), needle[0]);
+            if (first > lastStart) {
+                break;
+            }
+            if (first[needleSize - 1] == needle[needleSize - 1] &&
+                std::memcmp((first + 1), (needle + 1), (needleSize - 2)) == 0
+            ) {
+                return first;
+            }
+        }
+        return last;
+    }
+
+    // Occurrences of ch in [first, last).
+    inline size_t CountChar(const char* first, const char* last, char ch) noexcept
+    {
+        size_t count = 0;
+#if defined(_CU_STR_SEARCH_NEON)
+        auto target = vdupq_n_u8(static_cast<uint8_t>(ch));
+        while (static_cast<size_t>(last - first) >= 16) {
+            // Byte lanes count up to 255 before they are widened.
+            auto acc = vdupq_n_u8(0);
+            for (int round = 0; round < 255 && static_cast<size_t>(last - first) >= 16; round++, first += 16) {
+                acc = vsubq_u8(acc, vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(first)), target));
+            }
+            count += vaddlvq_u8(acc);
+        }
+#elif defined(_CU_STR_SEARCH_AVX2)
+        auto target = _mm256_set1_epi8(ch);
+        while (static_cast<size_t>(last - first) >= 32) {
+            auto acc = _mm256_setzero_si256();
+            for (int round = 0; round < 255 && static_cast<size_t>(last - first) >= 32; round++, first += 32) {
+                acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), target));
+            }
+            auto sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+            count += static_cast<size_t>(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+                                         _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+        }
+#elif defined(_CU_STR_SEARCH_SSE2)
+        auto target = _mm_set1_epi8(ch);
+        while (static_cast<size_t>(last - first) >= 16) {
+            auto acc = _mm_setzero_si128();
+            for (int round = 0; round < 255 && static_cast<size_t>(last - first) >= 16; round++, first += 16) {
+                acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), target));
+            }
+            auto sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+            count += static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+        }
+#endif
+        return (count + static_cast<size_t>(std::count(first, last, ch)));
+    }
+
+    // string_view forms, npos when nothing is found.
+    inline size_t StrFind(std::string_view str, char ch, size_t pos = 0) noexcept
+    {
+        if (pos >= str.size()) {
+            return std::string_view::npos;
+        }
+        auto end = str.data() + str.size();
+        auto found = FindChar((str.data() + pos), end, ch);
+        return (found != end) ? static_cast<size_t>(found - str.data()) : std::string_view::npos;
+    }
+
+    inline size_t StrFind(std::string_view str, std::string_view key, size_t pos = 0) noexcept
+    {
+        if (pos > str.size()) {
+            return std::string_view::npos;
+        }
+        auto end = str.data() + str.size();
+        auto found = FindStr((str.data() + pos), end, key.data(), key.size());
+        if (found == end && !(key.empty() && pos == str.size())) {
+            return std::string_view::npos;
+        }
+        return static_cast<size_t>(found - str.data());
+    }
+
+    inline size_t StrCount(std::string_view str, char ch) noexcept
+    {
+        return CountChar(str.data(), (str.data() + str.size()), ch);
+    }
+}
+
+#endif // _CU_STR_SEARCH_
@@ -0,0 +1,280 @@
+// CuSubprocess by chenzyadb@github.com
+// Based on C++17 STL (LLVM)
+
+#ifndef _CU_SUBPROCESS_
+#define _CU_SUBPROCESS_
+
+#if defined(__unix__) && defined(__GNUC__)
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <initializer_list>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include "CuClock.h"
+
+#if !defined(__NR_pidfd_open)
+#define __NR_pidfd_open 434
+#endif
+
+namespace CU
+{
+    // Runs a program directly with posix_spawn, no shell and no fork of the whole daemon.
+    // stdin and stderr go to /dev/null, stdout is captured or streamed. Not shared between threads,
+    // the output buffer is reused by the next run.
+    class Subprocess
+    {
+        public:
+            typedef std::function<bool(const std::string &)> LineReader;
+
+            struct Result
+            {
+                bool started;
+                // Killed because the deadline passed.
+                bool timedOut;
+                // -1 unless the program exited by itself.
+                int exitCode;
+                // 0 unless the program was killed by a signal.
+                int termSignal;
+                int64_t elapsedNs;
+
+                bool succeeded() const
+                {
+                    return (started && exitCode == 0);
+                }
+            };
+
+            Subprocess() : output_(), line_(), argv_() { }
+            Subprocess(Subprocess &) = delete;
+            Subprocess &operator=(Subprocess &) = delete;
+
+            // The program is looked up in PATH, a timeoutMs of 0 waits forever.
+            Result run(std::initializer_list<const char*> args, time_t timeoutMs)
+            {
+                return run_(args.begin(), args.size(), timeoutMs, nullptr);
+            }
+
+            // Feeds stdout line by line (without '\n') as it arrives, returning false from reader kills the program.
+            Result run(std::initializer_list<const char*> args, time_t timeoutMs, const LineReader &reader)
+            {
+                return run_(args.begin(), args.size(), timeoutMs, std::addressof(reader));
+            }
+
+            // For argument lists built at runtime.
+            Result run(const char* const* args, size_t argc, time_t timeoutMs)
+            {
+                return run_(args, argc, timeoutMs, nullptr);
+            }
+
+            // stdout of the last run without a reader.
+            const std::string &output() const
+            {
+                return output_;
+            }
+
+        private:
+            static constexpr size_t READ_CHUNK = 4096;
+
+            std::string output_;
+            std::string line_;
+            std::vector<char*> argv_;
+
+            Result run_(const char* const* args, size_t argc, time_t timeoutMs, const LineReader* reader)
+            {
+                Result result{false, false, -1, 0, 0};
+                auto startTime = CU::Clock::Default()->monotonicNs();
+                auto deadline = (timeoutMs > 0) ? (startTime + static_cast<int64_t>(timeoutMs) * 1000000LL) : INT64_MAX;
+                output_.clear();
+                line_.clear();
+                if (argc == 0) {
+                    return result;
+                }
+                argv_.clear();
+                for (size_t idx = 0; idx < argc; idx++) {
+                    argv_.emplace_back(const_cast<char*>(args[idx]));
+                }
+                argv_.emplace_back(nullptr);
+
+                int pipeFd[2] = { -1, -1 };
+                if (pipe2(pipeFd, O_CLOEXEC) < 0) {
+                    return result;
+                }
+                auto pid = Spawn_(argv_.data(), pipeFd[1]);
+                close(pipeFd[1]);
+                if (pid < 0) {
+                    close(pipeFd[0]);
+                    return result;
+                }
+                result.started = true;
+
+                bool stopped = false;
+                size_t length = 0;
+                char buffer[READ_CHUNK];
+                while (!stopped) {
+                    auto now = CU::Clock::Default()->monotonicNs();
+                    if (now >= deadline) {
+                        result.timedOut = true;
+                        break;
+                    }
+                    struct pollfd pollFd{pipeFd[0], POLLIN, 0};
+                    int pollTimeout = (deadline == INT64_MAX) ? -1 : static_cast<int>((deadline - now + 999999LL) / 1000000LL);
+                    int ret = poll(std::addressof(pollFd), 1, pollTimeout);
+                    if (ret < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (ret < 0) {
+                        break;
+                    }
+                    if (ret == 0) {
+                        continue;
+                    }
+                    char* dst = buffer;
+                    size_t dstSize = sizeof(buffer);
+                    if (reader == nullptr) {
+                        if ((output_.size() - length) < READ_CHUNK) {
+                            output_.resize(length + READ_CHUNK * ((length / READ_CHUNK) + 1));
+                        }
+                        dst = output_.data() + length;
+                        dstSize = output_.size() - length;
+                    }
+                    auto len = read(pipeFd[0], dst, dstSize);
+                    if (len < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (len <= 0) {
+                        break;
+                    }
+                    if (reader == nullptr) {
+                        length += static_cast<size_t>(len);
+                    } else {
+                        stopped = !FeedLines_(buffer, static_cast<size_t>(len), *reader);
+                    }
+                }
+                close(pipeFd[0]);
+                if (reader == nullptr) {
+                    output_.resize(length);
+                } else if (!stopped && !result.timedOut && !line_.empty()) {
+                    (*reader)(line_);
+                }
+                if (stopped || result.timedOut) {
+                    kill(pid, SIGKILL);
+                }
+
+                int status = 0;
+                if (!Wait_(pid, deadline, status)) {
+                    result.timedOut = true;
+                }
+                if (WIFEXITED(status)) {
+                    result.exitCode = WEXITSTATUS(status);
+                } else if (WIFSIGNALED(status)) {
+                    result.termSignal = WTERMSIG(status);
+                }
+                result.elapsedNs = CU::Clock::Default()->monotonicNs() - startTime;
+                return result;
+            }
+
+            bool FeedLines_(const char* begin, size_t len, const LineReader &reader)
+            {
+                auto end = begin + len;
+                while (begin < end) {
+                    auto lineEnd = static_cast<const char*>(std::memchr(begin, '\n', (end - begin)));
+                    if (lineEnd == nullptr) {
+                        line_.append(begin, (end - begin));
+                        break;
+                    }
+                    line_.append(begin, (lineEnd - begin));
+                    if (!reader(line_)) {
+                        return false;
+                    }
+                    line_.clear();
+                    begin = lineEnd + 1;
+                }
+                return true;
+            }
+
+            static pid_t Spawn_(char* const* argv, int stdoutFd)
+            {
+                posix_spawn_file_actions_t fileActions{};
+                posix_spawn_file_actions_init(std::addressof(fileActions));
+                posix_spawn_file_actions_addopen(std::addressof(fileActions), STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+                posix_spawn_file_actions_adddup2(std::addressof(fileActions), stdoutFd, STDOUT_FILENO);
+                posix_spawn_file_actions_addopen(std::addressof(fileActions), STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+                // Worker threads may block signals, the program should start with a clean mask and default handlers.
+                posix_spawnattr_t attr{};
+                posix_spawnattr_init(std::addressof(attr));
+                sigset_t signals{};
+                sigemptyset(std::addressof(signals));
+                posix_spawnattr_setsigmask(std::addressof(attr), std::addressof(signals));
+                sigaddset(std::addressof(signals), SIGPIPE);
+                posix_spawnattr_setsigdefault(std::addressof(attr), std::addressof(signals));
+                posix_spawnattr_setflags(std::addressof(attr), (POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF));
+                pid_t pid = -1;
+                int ret = posix_spawnp(std::addressof(pid), argv[0], std::addressof(fileActions), std::addressof(attr),
+                                       argv, environ);
+                posix_spawnattr_destroy(std::addressof(attr));
+                posix_spawn_file_actions_destroy(std::addressof(fileActions));
+                return (ret == 0) ? pid : -1;
+            }
+
+            // Reaps the program, killing it once the deadline passes. Returns false if it had to be killed.
+            static bool Wait_(pid_t pid, int64_t deadline, int &status)
+            {
+                if (deadline == INT64_MAX) {
+                    while (waitpid(pid, std::addressof(status), 0) < 0 && errno == EINTR) { }
+                    return true;
+                }
+                // A pidfd becomes readable on exit (Linux 5.3+), older kernels poll waitpid with a backoff.
+                int pidFd = static_cast<int>(syscall(__NR_pidfd_open, pid, 0));
+                if (pidFd >= 0) {
+                    bool exited = false;
+                    for (;;) {
+                        auto now = CU::Clock::Default()->monotonicNs();
+                        if (now >= deadline) {
+                            break;
+                        }
+                        struct pollfd pollFd{pidFd, POLLIN, 0};
+                        int ret = poll(std::addressof(pollFd), 1, static_cast<int>((deadline - now + 999999LL) / 1000000LL));
+                        // Reaping blocks if poll itself fails, as without a deadline.
+                        if (ret > 0 || (ret < 0 && errno != EINTR)) {
+                            exited = true;
+                            break;
+                        }
+                    }
+                    close(pidFd);
+                    if (!exited) {
+                        kill(pid, SIGKILL);
+                    }
+                    while (waitpid(pid, std::addressof(status), 0) < 0 && errno == EINTR) { }
+                    return exited;
+                }
+                useconds_t interval = 100;
+                for (;;) {
+                    auto ret = waitpid(pid, std::addressof(status), WNOHANG);
+                    if (ret == pid || (ret < 0 && errno != EINTR)) {
+                        return true;
+                    }
+                    if (CU::Clock::Default()->monotonicNs() >= deadline) {
+                        kill(pid, SIGKILL);
+                        while (waitpid(pid, std::addressof(status), 0) < 0 && errno == EINTR) { }
+                        return false;
+                    }
+                    usleep(interval);
+                    interval = std::min<useconds_t>((interval * 2), 10000);
+                }
+            }
+    };
+}
+
+#endif // __unix__ && __GNUC__
+#endif // _CU_SUBPROCESS_
@@ -1,15 +1,16 @@
 // CuTimer by chenzyadb@github.com
-// Based on C++17 STL (MSVC)
+// Based on C++17 STL (LLVM)
 
 #ifndef _CU_TIMER_
 #define _CU_TIMER_
 
-#include <chrono>
-#include <thread>
+#include <atomic>
+#include <algorithm>
 #include <mutex>
+#include <string>
+#include <exception>
 #include <functional>
-
-#define TIMER_LOOP(timer) while((timer)._Timer_Condition())
+#include "CuTimerService.h"
 
 namespace CU
 {
@@ -27,21 +28,25 @@ namespace CU
             const std::string message_;
     };
 
+    // Periodic, pausable timer served by the shared TimerService, a paused or stopped timer costs nothing.
+    // Periods follow absolute deadlines, the callback runtime does not shift the next one and missed
+    // periods are skipped instead of fired in a burst. The callback runs on the timer thread.
     class Timer
     {
         public:
             typedef std::function<void(void)> Task;
 
-            static void SingleShot(time_t interval, const Task &callback)
+            static TimerHandle SingleShot(time_t interval, const Task &callback, time_t slack = 0)
             {
-                std::thread timerThread([interval, callback]() {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(interval));
-                    callback();
-                });
-                timerThread.detach();
+                return TimerService::GetInstance()->arm(interval, callback, slack);
             }
 
-            Timer() : interval_(0), loop_(), mtx_(), cv_(), started_(false), paused_(false), requestStop_(false) { }
+            static bool Cancel(const TimerHandle &handle)
+            {
+                return TimerService::GetInstance()->cancel(handle);
+            }
+
+            Timer() : interval_(0), slack_(0), callback_(), mtx_(), handle_(), deadline_(0), started_(false), paused_(false) { }
 
             ~Timer()
             {
@@ -50,93 +55,119 @@ namespace CU
                 }
             }
 
-            bool _Timer_Condition()
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(interval_));
-                if (paused_) {
-                    std::unique_lock<std::mutex> lock(mtx_);
-                    while (paused_) {
-                        cv_.wait(lock);
-                    }
-                }
-                return !requestStop_;
-            }
-
             void setInterval(time_t interval)
             {
                 interval_ = interval;
             }
 
-            void setLoop(const Task &loop)
+            // How late (ms) each expiration may fire so that it can share a wakeup with other timers.
+            void setSlack(time_t slack)
             {
-                loop_ = loop;
+                slack_ = slack;
             }
 
             void setTimeOutCallback(const Task &callback)
             {
-                setLoop([this, callback]() {
-                    while (_Timer_Condition()) { 
-                        callback();
-                    }
-                });
+                std::unique_lock<std::mutex> lock(mtx_);
+                callback_ = callback;
             }
 
             void start()
             {
+                std::unique_lock<std::mutex> lock(mtx_);
                 if (started_) {
                     throw TimerExcept("Timer already started.");
                 }
-                std::thread thread_(std::bind(&CU::Timer::TimerThread_, this));
-                thread_.detach();
+                started_ = true;
+                if (!paused_) {
+                    Arm_();
+                }
             }
 
             void stop()
             {
+                std::unique_lock<std::mutex> lock(mtx_);
                 if (!started_) {
                     throw TimerExcept("Timer already stoped.");
                 }
-                requestStop_ = true;
-                if (paused_) {
-                    continueTimer();
-                }
-                while (started_) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(interval_ / 2));
-                }
-                requestStop_ = false;
+                started_ = false;
+                Disarm_();
             }
 
             void pauseTimer()
             {
+                std::unique_lock<std::mutex> lock(mtx_);
                 if (!paused_) {
                     paused_ = true;
+                    Disarm_();
                 }
             }
 
+            // Restarts the period from now.
             void continueTimer()
             {
+                std::unique_lock<std::mutex> lock(mtx_);
                 if (paused_) {
-                    std::unique_lock<std::mutex> lock{};
                     paused_ = false;
-                    cv_.notify_all();
+                    if (started_ && !handle_.valid()) {
+                        Arm_();
+                    }
                 }
             }
 
         private:
-            volatile time_t interval_;
-            Task loop_;
+            std::atomic<time_t> interval_;
+            std::atomic<time_t> slack_;
+            Task callback_;
             std::mutex mtx_;
-            std::condition_variable cv_;
-            volatile bool started_;
-            volatile bool paused_;
-            volatile bool requestStop_;
+            TimerHandle handle_;
+            uint64_t deadline_;
+            bool started_;
+            bool paused_;
 
-            void TimerThread_()
+            void Arm_()
             {
-                started_ = true;
-                if (loop_) {
-                    loop_();
+                auto service = TimerService::GetInstance();
+                deadline_ = service->now() + static_cast<uint64_t>(std::max<time_t>(interval_, 1));
+                handle_ = service->armAt(deadline_, std::bind(&Timer::TimeOut_, this), slack_);
+            }
+
+            void Rearm_()
+            {
+                auto service = TimerService::GetInstance();
+                auto interval = static_cast<uint64_t>(std::max<time_t>(interval_, 1));
+                auto now = service->now();
+                deadline_ += interval;
+                if (deadline_ <= now) {
+                    deadline_ += ((now - deadline_) / interval + 1) * interval;
+                }
+                handle_ = service->armAt(deadline_, std::bind(&Timer::TimeOut_, this), slack_);
+            }
+
+            void Disarm_()
+            {
+                if (handle_.valid()) {
+                    TimerService::GetInstance()->cancel(handle_);
+                    handle_ = TimerHandle{};
+                }
+            }
+
+            void TimeOut_()
+            {
+                Task callback{};
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    handle_ = TimerHandle{};
+                    if (!started_ || paused_) {
+                        return;
+                    }
+                    callback = callback_;
+                }
+                callback();
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (started_ && !paused_ && !handle_.valid()) {
+                    Rearm_();
                 }
-                started_ = false;
             }
     };
 }
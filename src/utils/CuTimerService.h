@@ -0,0 +1,388 @@
+// CuTimerService by chenzyadb@github.com
+// Based on C++17 STL (LLVM)
+
+#ifndef _CU_TIMER_SERVICE_
+#define _CU_TIMER_SERVICE_
+
+#if defined(__linux__) && defined(__GNUC__)
+
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include "CuClock.h"
+
+namespace CU
+{
+    // Identifies one armed expiration, stale handles are rejected by the generation.
+    struct TimerHandle
+    {
+        uint32_t index;
+        uint32_t generation;
+
+        bool valid() const noexcept
+        {
+            return (generation != 0);
+        }
+    };
+
+    // All timers of the process share one thread and one timerfd.
+    // Pending expirations live in a hierarchical timing wheel (4 levels of 64 slots, 1 ms ticks),
+    // arming and cancelling are O(1), the timerfd is only programmed for the nearest expiration.
+    // Callbacks run on the timer thread and must stay short, post real work elsewhere.
+    // Time comes from Clock::Default(), under a VirtualClock there is no thread and timers fire
+    // from VirtualClock::advance() instead.
+    class TimerService : public ClockListener
+    {
+        public:
+            typedef std::function<void(void)> Task;
+
+            static TimerService* GetInstance()
+            {
+                static TimerService* instance = nullptr;
+                static std::once_flag flag{};
+                std::call_once(flag, []() {
+                    instance = new TimerService();
+                });
+                return instance;
+            }
+
+            // Milliseconds on the service's CLOCK_MONOTONIC timeline, the unit of absolute deadlines.
+            uint64_t now() const
+            {
+                return NowTick_();
+            }
+
+            TimerHandle arm(time_t delay, const Task &callback, time_t slack = 0)
+            {
+                return armAt(NowTick_() + static_cast<uint64_t>(std::max<time_t>(delay, 0)), callback, slack);
+            }
+
+            // Fires once now() reaches deadline, or up to slack ms later so that nearby timers share a wakeup.
+            TimerHandle armAt(uint64_t deadline, const Task &callback, time_t slack = 0)
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                uint64_t nowTick = NowTick_();
+                if (pending_ == 0 && nowTick > currentTick_) {
+                    // Nothing to cascade, catch up so an idle wheel does not wake up just to advance.
+                    currentTick_ = nowTick - 1;
+                }
+                uint64_t expiry = ApplySlack_(deadline, slack);
+                if (expiry <= currentTick_) {
+                    expiry = currentTick_ + 1;
+                }
+                uint32_t index = AllocNode_();
+                auto &node = nodes_[index];
+                node.expiry = expiry;
+                node.callback = callback;
+                Link_(index);
+                if (expiry < programmedTick_) {
+                    Program_();
+                }
+                return TimerHandle{index, node.generation};
+            }
+
+            // Returns false if the timer already fired or was cancelled, a running callback is not waited for.
+            bool cancel(const TimerHandle &handle)
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                if (!handle.valid() || handle.index >= nodes_.size() || nodes_[handle.index].generation != handle.generation) {
+                    return false;
+                }
+                Unlink_(handle.index);
+                FreeNode_(handle.index);
+                // The timerfd is left as is, an early wakeup finds nothing and reprograms.
+                return true;
+            }
+
+            size_t pending() const
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                return pending_;
+            }
+
+        private:
+            static constexpr uint32_t NIL = UINT32_MAX;
+            static constexpr uint32_t LEVEL_BITS = 6;
+            static constexpr uint32_t LEVEL_SLOTS = (1U << LEVEL_BITS);
+            static constexpr uint32_t LEVELS = 4;
+            static constexpr uint32_t OVERFLOW_SLOT = LEVELS * LEVEL_SLOTS;
+
+            struct Node
+            {
+                uint64_t expiry;
+                uint32_t prev;
+                uint32_t next;
+                uint32_t slot;
+                uint32_t generation;
+                Task callback;
+            };
+
+            mutable std::mutex mtx_;
+            std::vector<Node> nodes_;
+            uint32_t freeHead_;
+            uint32_t slots_[OVERFLOW_SLOT + 1];
+            uint64_t bitmaps_[LEVELS];
+            uint64_t currentTick_;
+            uint64_t programmedTick_;
+            size_t pending_;
+            Clock* clock_;
+            int64_t originNs_;
+            bool virtual_;
+            int timerFd_;
+
+            TimerService() :
+                mtx_(),
+                nodes_(),
+                freeHead_(NIL),
+                slots_(),
+                bitmaps_(),
+                currentTick_(0),
+                programmedTick_(UINT64_MAX),
+                pending_(0),
+                clock_(Clock::Default()),
+                originNs_(clock_->monotonicNs()),
+                virtual_(false),
+                timerFd_(-1)
+            {
+                for (auto &slot : slots_) {
+                    slot = NIL;
+                }
+                virtual_ = clock_->attach(this);
+                if (virtual_) {
+                    return;
+                }
+                timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+                if (timerFd_ < 0) {
+                    throw std::runtime_error("Failed to create timerfd.");
+                }
+                std::thread thread_(std::bind(&TimerService::TimerMain_, this));
+                thread_.detach();
+            }
+
+            TimerService(const TimerService &other) = delete;
+            TimerService &operator=(const TimerService &other) = delete;
+
+            uint64_t NowTick_() const
+            {
+                return static_cast<uint64_t>((clock_->monotonicNs() - originNs_) / 1000000LL);
+            }
+
+            // Rounds the deadline up to the coarsest power-of-two boundary inside [deadline, deadline + slack],
+            // timers with overlapping windows then land on the same tick and expire in one wakeup.
+            static uint64_t ApplySlack_(uint64_t deadline, time_t slack)
+            {
+                if (slack <= 0) {
+                    return deadline;
+                }
+                uint64_t limit = deadline + static_cast<uint64_t>(slack);
+                uint64_t mask = deadline ^ limit;
+                if (mask == 0) {
+                    return deadline;
+                }
+                mask = (1ULL << (63 - __builtin_clzll(mask))) - 1;
+                return (limit & ~mask);
+            }
+
+            uint32_t AllocNode_()
+            {
+                if (freeHead_ == NIL) {
+                    nodes_.emplace_back(Node{0, NIL, NIL, NIL, 1, Task()});
+                    return static_cast<uint32_t>(nodes_.size() - 1);
+                }
+                uint32_t index = freeHead_;
+                freeHead_ = nodes_[index].next;
+                return index;
+            }
+
+            void FreeNode_(uint32_t index)
+            {
+                auto &node = nodes_[index];
+                node.callback = nullptr;
+                node.generation = (node.generation == UINT32_MAX) ? 1 : (node.generation + 1);
+                node.slot = NIL;
+                node.prev = NIL;
+                node.next = freeHead_;
+                freeHead_ = index;
+            }
+
+            // Level L holds expirations that share the tick bits above L with the current tick,
+            // so each pending slot is strictly ahead of the wheel and is visited before it wraps.
+            uint32_t SlotOf_(uint64_t expiry) const
+            {
+                for (uint32_t level = 0; level < LEVELS; level++) {
+                    uint32_t shift = LEVEL_BITS * (level + 1);
+                    if ((expiry >> shift) == (currentTick_ >> shift)) {
+                        return (level * LEVEL_SLOTS + static_cast<uint32_t>((expiry >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1)));
+                    }
+                }
+                return OVERFLOW_SLOT;
+            }
+
+            void Link_(uint32_t index)
+            {
+                auto &node = nodes_[index];
+                node.slot = SlotOf_(node.expiry);
+                node.prev = NIL;
+                node.next = slots_[node.slot];
+                if (node.next != NIL) {
+                    nodes_[node.next].prev = index;
+                }
+                slots_[node.slot] = index;
+                if (node.slot != OVERFLOW_SLOT) {
+                    bitmaps_[node.slot / LEVEL_SLOTS] |= (1ULL << (node.slot % LEVEL_SLOTS));
+                }
+                pending_++;
+            }
+
+            void Unlink_(uint32_t index)
+            {
+                auto &node = nodes_[index];
+                if (node.prev != NIL) {
+                    nodes_[node.prev].next = node.next;
+                } else {
+                    slots_[node.slot] = node.next;
+                }
+                if (node.next != NIL) {
+                    nodes_[node.next].prev = node.prev;
+                }
+                if (slots_[node.slot] == NIL && node.slot != OVERFLOW_SLOT) {
+                    bitmaps_[node.slot / LEVEL_SLOTS] &= ~(1ULL << (node.slot % LEVEL_SLOTS));
+                }
+                pending_--;
+            }
+
+            // The earliest tick at which the wheel has to do anything, expire a slot or cascade one.
+            uint64_t NextTick_() const
+            {
+                uint64_t nextTick = UINT64_MAX;
+                for (uint32_t level = 0; level < LEVELS; level++) {
+                    uint32_t shift = LEVEL_BITS * level;
+                    uint32_t curIdx = static_cast<uint32_t>((currentTick_ >> shift) & (LEVEL_SLOTS - 1));
+                    uint64_t ahead = (curIdx == (LEVEL_SLOTS - 1)) ? 0 : (bitmaps_[level] & (~0ULL << (curIdx + 1)));
+                    if (ahead != 0) {
+                        uint64_t base = (currentTick_ >> (shift + LEVEL_BITS)) << (shift + LEVEL_BITS);
+                        uint64_t tick = base + (static_cast<uint64_t>(__builtin_ctzll(ahead)) << shift);
+                        nextTick = std::min(nextTick, tick);
+                    }
+                }
+                if (slots_[OVERFLOW_SLOT] != NIL) {
+                    uint32_t shift = LEVEL_BITS * LEVELS;
+                    nextTick = std::min(nextTick, ((currentTick_ >> shift) + 1) << shift);
+                }
+                return nextTick;
+            }
+
+            void Cascade_(uint32_t slot)
+            {
+                uint32_t index = slots_[slot];
+                while (index != NIL) {
+                    uint32_t next = nodes_[index].next;
+                    Unlink_(index);
+                    Link_(index);
+                    index = next;
+                }
+            }
+
+            void Advance_(uint64_t nowTick, std::vector<Task> &expired)
+            {
+                for (;;) {
+                    uint64_t tick = NextTick_();
+                    if (tick > nowTick) {
+                        break;
+                    }
+                    currentTick_ = tick;
+                    if ((tick & ((1ULL << (LEVEL_BITS * LEVELS)) - 1)) == 0) {
+                        Cascade_(OVERFLOW_SLOT);
+                    }
+                    for (uint32_t level = LEVELS - 1; level > 0; level--) {
+                        uint32_t shift = LEVEL_BITS * level;
+                        if ((tick & ((1ULL << shift) - 1)) == 0) {
+                            Cascade_(level * LEVEL_SLOTS + static_cast<uint32_t>((tick >> shift) & (LEVEL_SLOTS - 1)));
+                        }
+                    }
+                    uint32_t slot = static_cast<uint32_t>(tick & (LEVEL_SLOTS - 1));
+                    uint32_t index = slots_[slot];
+                    while (index != NIL) {
+                        uint32_t next = nodes_[index].next;
+                        Unlink_(index);
+                        expired.emplace_back(std::move(nodes_[index].callback));
+                        FreeNode_(index);
+                        index = next;
+                    }
+                }
+                if (nowTick > currentTick_) {
+                    currentTick_ = nowTick;
+                }
+            }
+
+            void Program_()
+            {
+                struct itimerspec its{};
+                programmedTick_ = (pending_ > 0) ? NextTick_() : UINT64_MAX;
+                if (virtual_) {
+                    return;
+                }
+                if (programmedTick_ != UINT64_MAX) {
+                    int64_t ns = originNs_ + static_cast<int64_t>(programmedTick_) * 1000000LL;
+                    its.it_value.tv_sec = static_cast<time_t>(ns / 1000000000LL);
+                    its.it_value.tv_nsec = static_cast<long>(ns % 1000000000LL);
+                }
+                timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, std::addressof(its), nullptr);
+            }
+
+            void TimerMain_()
+            {
+                prctl(PR_SET_NAME, "TimerService");
+
+                std::vector<Task> expired{};
+                for (;;) {
+                    uint64_t expirations = 0;
+                    if (read(timerFd_, std::addressof(expirations), sizeof(expirations)) < 0 && errno != EINTR) {
+                        break;
+                    }
+                    Expire_(expired);
+                }
+            }
+
+            void Expire_(std::vector<Task> &expired)
+            {
+                {
+                    std::unique_lock<std::mutex> lck(mtx_);
+                    Advance_(NowTick_(), expired);
+                    Program_();
+                }
+                for (auto &task : expired) {
+                    task();
+                }
+                expired.clear();
+            }
+
+            int64_t nextDeadline() override
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                uint64_t nextTick = (pending_ > 0) ? NextTick_() : UINT64_MAX;
+                if (nextTick == UINT64_MAX) {
+                    return INT64_MAX;
+                }
+                return (originNs_ + static_cast<int64_t>(nextTick) * 1000000LL);
+            }
+
+            void clockAdvanced() override
+            {
+                std::vector<Task> expired{};
+                Expire_(expired);
+            }
+    };
+}
+
+#endif // __linux__ && __GNUC__
+#endif // _CU_TIMER_SERVICE_
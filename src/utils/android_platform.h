@@ -12,11 +12,16 @@ inline ScreenState GetScreenState()
 {
     static const int android_api_level = android_get_device_api_level();
     if (android_api_level < __ANDROID_API_R__) {
-        if (CU::StrContains(CU::ReadFile("/sys/power/wake_unlock"), "PowerManagerService.Display")) {
+        thread_local CU::KernelFileCache files(1);
+        if (CU::StrContains(files.read("/sys/power/wake_unlock"), "PowerManagerService.Display")) {
             return ScreenState::SCREEN_OFF;
         }
     } else {
-        if (CU::StrSplit(CU::ReadFile("/dev/cpuset/restricted/tasks"), '\n').size() > 10) {
+        // One pid per line, a missing final newline still counts as a task.
+        // Opened fresh, an open cgroup v1 tasks file keeps serving the pidlist of its first read.
+        auto tasks = CU::ReadFile("/dev/cpuset/restricted/tasks");
+        auto taskCount = CU::StrCount(tasks, '\n') + (!tasks.empty() && tasks.back() != '\n');
+        if (taskCount > 10) {
             return ScreenState::SCREEN_OFF;
         }
     }
@@ -5,9 +5,11 @@
 #define __LIB_CU__
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <chrono>
 #include <thread>
@@ -21,6 +23,9 @@
 #include <cstddef>
 #include <cinttypes>
 #include <cwchar>
+#include "CuClock.h"
+#include "CuCharConv.h"
+#include "CuStrSearch.h"
 
 #define CU_UNUSED(val) (void)(val)
 #define CU_WCHAR(val) L##val
@@ -426,13 +431,19 @@ namespace CU
     template <typename _Char_Ty>
     CU_INLINE bool StrContains(const std::basic_string<_Char_Ty> &str, const std::basic_string<_Char_Ty> &key) noexcept
     {
-        return (str.find(key) != std::string::npos);
+        if constexpr (std::is_same<_Char_Ty, char>::value) {
+            return (StrFind(str, key) != std::string::npos);
+        }
+        return (str.find(key) != std::basic_string<_Char_Ty>::npos);
     }
 
     template <typename _Char_Ty>
     CU_INLINE bool StrContains(const std::basic_string<_Char_Ty> &str, const _Char_Ty* key) noexcept
     {
-        return (str.find(key) != std::string::npos);
+        if constexpr (std::is_same<_Char_Ty, char>::value) {
+            return (StrFind(str, key) != std::string::npos);
+        }
+        return (str.find(key) != std::basic_string<_Char_Ty>::npos);
     }
 
     template <typename _Char_Ty>
@@ -487,14 +498,9 @@ namespace CU
 
     CU_INLINE int StrToInt(const std::string &str) noexcept
     {
-        long integer = std::strtol(str.c_str(), nullptr, 10);
-        if (integer > INT_MAX) {
-            return INT_MAX;
-        }
-        if (integer < INT_MIN) {
-            return INT_MIN;
-        }
-        return static_cast<int>(integer);
+        int integer = 0;
+        ParseInt(str, integer);
+        return integer;
     }
 
     CU_INLINE int StrToInt(const std::wstring &str) noexcept
@@ -511,7 +517,9 @@ namespace CU
 
     CU_INLINE int64_t StrToLong(const std::string &str) noexcept
     {
-        return std::strtoll(str.c_str(), nullptr, 10);
+        int64_t integer = 0;
+        ParseInt(str, integer);
+        return integer;
     }
 
     CU_INLINE int64_t StrToLong(const std::wstring &str) noexcept
@@ -521,7 +529,9 @@ namespace CU
 
     CU_INLINE uint64_t StrToULong(const std::string &str) noexcept
     {
-        return std::strtoull(str.c_str(), nullptr, 10);
+        uint64_t integer = 0;
+        ParseInt(str, integer);
+        return integer;
     }
 
     CU_INLINE uint64_t StrToULong(const std::wstring &str) noexcept
@@ -531,7 +541,57 @@ namespace CU
 
     CU_INLINE double StrToDouble(const std::string &str) noexcept
     {
-        return std::strtod(str.c_str(), nullptr);
+        double value = 0;
+        ParseDouble(str, value);
+        return value;
+    }
+
+    CU_INLINE int StrToInt(std::string_view str) noexcept
+    {
+        int integer = 0;
+        ParseInt(str, integer);
+        return integer;
+    }
+
+    CU_INLINE int StrToInt(const char* str) noexcept
+    {
+        return StrToInt(std::string_view(str));
+    }
+
+    CU_INLINE int64_t StrToLong(std::string_view str) noexcept
+    {
+        int64_t integer = 0;
+        ParseInt(str, integer);
+        return integer;
+    }
+
+    CU_INLINE int64_t StrToLong(const char* str) noexcept
+    {
+        return StrToLong(std::string_view(str));
+    }
+
+    CU_INLINE uint64_t StrToULong(std::string_view str) noexcept
+    {
+        uint64_t integer = 0;
+        ParseInt(str, integer);
+        return integer;
+    }
+
+    CU_INLINE uint64_t StrToULong(const char* str) noexcept
+    {
+        return StrToULong(std::string_view(str));
+    }
+
+    CU_INLINE double StrToDouble(std::string_view str) noexcept
+    {
+        double value = 0;
+        ParseDouble(str, value);
+        return value;
+    }
+
+    CU_INLINE double StrToDouble(const char* str) noexcept
+    {
+        return StrToDouble(std::string_view(str));
     }
 
     CU_INLINE double StrToDouble(const std::wstring &str) noexcept
@@ -573,6 +633,293 @@ namespace CU
         return trimedStr;
     }
 
+    // string_view counterparts of the helpers above. They return views into str and never allocate,
+    // the caller keeps str alive. Empty pieces are skipped when splitting, the last piece is kept whole.
+
+    template <typename _Ty>
+    struct _Non_Deduced
+    {
+        typedef _Ty type;
+    };
+
+    template <typename _Char_Ty>
+    class StrTokenizer
+    {
+        public:
+            typedef std::basic_string_view<_Char_Ty> view_type;
+
+            class iterator
+            {
+                public:
+                    typedef std::input_iterator_tag iterator_category;
+                    typedef view_type value_type;
+                    typedef std::ptrdiff_t difference_type;
+                    typedef const view_type* pointer;
+                    typedef const view_type &reference;
+
+                    iterator() : owner_(nullptr), token_(), pos_(view_type::npos) { }
+
+                    iterator(const StrTokenizer* owner, size_t pos) : owner_(owner), token_(), pos_(pos)
+                    {
+                        advance_();
+                    }
+
+                    reference operator*() const noexcept
+                    {
+                        return token_;
+                    }
+
+                    pointer operator->() const noexcept
+                    {
+                        return std::addressof(token_);
+                    }
+
+                    iterator &operator++()
+                    {
+                        advance_();
+                        return *this;
+                    }
+
+                    iterator operator++(int)
+                    {
+                        auto prev = *this;
+                        advance_();
+                        return prev;
+                    }
+
+                    bool operator==(const iterator &other) const noexcept
+                    {
+                        return (owner_ == other.owner_ && pos_ == other.pos_);
+                    }
+
+                    bool operator!=(const iterator &other) const noexcept
+                    {
+                        return !(*this == other);
+                    }
+
+                private:
+                    const StrTokenizer* owner_;
+                    view_type token_;
+                    size_t pos_;
+
+                    void advance_()
+                    {
+                        if (owner_ == nullptr || !owner_->find_(pos_, token_)) {
+                            owner_ = nullptr;
+                            pos_ = view_type::npos;
+                        }
+                    }
+            };
+
+            StrTokenizer(view_type str, _Char_Ty delimiter) noexcept : 
+                str_(str), delimiter_(), delimiterChar_(delimiter), charDelimiter_(true), pos_(0) { }
+
+            // A delimiter that is not a literal has to outlive the tokenizer, an empty one yields str whole.
+            StrTokenizer(view_type str, view_type delimiter) noexcept : 
+                str_(str), delimiter_(delimiter), delimiterChar_(), charDelimiter_(delimiter.size() == 1), pos_(0) 
+            {
+                if (charDelimiter_) {
+                    delimiterChar_ = delimiter_.front();
+                }
+            }
+
+            // Pulls the next piece, false at the end.
+            bool next(view_type &token)
+            {
+                return find_(pos_, token);
+            }
+
+            iterator begin() const
+            {
+                return iterator(this, pos_);
+            }
+
+            iterator end() const
+            {
+                return iterator();
+            }
+
+        private:
+            view_type str_;
+            view_type delimiter_;
+            _Char_Ty delimiterChar_;
+            bool charDelimiter_;
+            size_t pos_;
+
+            bool find_(size_t &pos, view_type &token) const
+            {
+                size_t delimiterSize = charDelimiter_ ? 1 : delimiter_.size();
+                while (pos < str_.size()) {
+                    size_t end = view_type::npos;
+                    if constexpr (std::is_same<_Char_Ty, char>::value) {
+                        if (charDelimiter_) {
+                            end = StrFind(str_, delimiterChar_, pos);
+                        } else if (delimiterSize > 0) {
+                            end = StrFind(str_, delimiter_, pos);
+                        }
+                    } else {
+                        if (charDelimiter_) {
+                            end = str_.find(delimiterChar_, pos);
+                        } else if (delimiterSize > 0) {
+                            end = str_.find(delimiter_, pos);
+                        }
+                    }
+                    if (end == view_type::npos) {
+                        end = str_.size();
+                    }
+                    if (end > pos) {
+                        token = str_.substr(pos, (end - pos));
+                        pos = (end == str_.size()) ? end : (end + delimiterSize);
+                        return true;
+                    }
+                    pos = end + delimiterSize;
+                }
+                return false;
+            }
+    };
+
+    template <typename _Char_Ty>
+    CU_INLINE StrTokenizer<_Char_Ty> StrSplitView(std::basic_string_view<_Char_Ty> str, _Char_Ty delimiter) noexcept
+    {
+        return StrTokenizer<_Char_Ty>(str, delimiter);
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE StrTokenizer<_Char_Ty> StrSplitView(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type delimiter) noexcept
+    {
+        return StrTokenizer<_Char_Ty>(str, delimiter);
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> StrSplitAt(std::basic_string_view<_Char_Ty> str, _Char_Ty delimiter, int targetCount) noexcept
+    {
+        StrTokenizer<_Char_Ty> tokenizer(str, delimiter);
+        std::basic_string_view<_Char_Ty> token{};
+        for (int count = 0; tokenizer.next(token); count++) {
+            if (count == targetCount) {
+                return token;
+            }
+        }
+        return {};
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> StrSplitAt(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type delimiter, int targetCount) noexcept
+    {
+        StrTokenizer<_Char_Ty> tokenizer(str, delimiter);
+        std::basic_string_view<_Char_Ty> token{};
+        for (int count = 0; tokenizer.next(token); count++) {
+            if (count == targetCount) {
+                return token;
+            }
+        }
+        return {};
+    }
+
+    // Before the first delimiter, all of str without one.
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubPrevStr(std::basic_string_view<_Char_Ty> str, _Char_Ty delimiter) noexcept
+    {
+        return str.substr(0, str.find(delimiter));
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubPrevStr(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type delimiter) noexcept
+    {
+        return str.substr(0, str.find(delimiter));
+    }
+
+    // Before the last delimiter, all of str without one.
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubRePrevStr(std::basic_string_view<_Char_Ty> str, _Char_Ty delimiter) noexcept
+    {
+        return str.substr(0, str.rfind(delimiter));
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubRePrevStr(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type delimiter) noexcept
+    {
+        return str.substr(0, str.rfind(delimiter));
+    }
+
+    // After the first delimiter, empty without one.
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubPostStr(std::basic_string_view<_Char_Ty> str, _Char_Ty delimiter) noexcept
+    {
+        auto pos = str.find(delimiter);
+        return (pos != std::basic_string_view<_Char_Ty>::npos) ? str.substr(pos + 1) : std::basic_string_view<_Char_Ty>();
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubPostStr(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type delimiter) noexcept
+    {
+        auto pos = str.find(delimiter);
+        return (pos != std::basic_string_view<_Char_Ty>::npos) ? str.substr(pos + delimiter.size()) : std::basic_string_view<_Char_Ty>();
+    }
+
+    // After the last delimiter, empty without one.
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubRePostStr(std::basic_string_view<_Char_Ty> str, _Char_Ty delimiter) noexcept
+    {
+        auto pos = str.rfind(delimiter);
+        return (pos != std::basic_string_view<_Char_Ty>::npos) ? str.substr(pos + 1) : std::basic_string_view<_Char_Ty>();
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> SubRePostStr(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type delimiter) noexcept
+    {
+        auto pos = str.rfind(delimiter);
+        return (pos != std::basic_string_view<_Char_Ty>::npos) ? str.substr(pos + delimiter.size()) : std::basic_string_view<_Char_Ty>();
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE bool StrContains(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type key) noexcept
+    {
+        if constexpr (std::is_same<_Char_Ty, char>::value) {
+            return (StrFind(str, key) != std::string_view::npos);
+        }
+        return (str.find(key) != std::basic_string_view<_Char_Ty>::npos);
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE bool StrStartsWith(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type key) noexcept
+    {
+        return (key.size() > 0 && str.size() >= key.size() && str.compare(0, key.size(), key) == 0);
+    }
+
+    template <typename _Char_Ty>
+    CU_INLINE bool StrEndsWith(std::basic_string_view<_Char_Ty> str, 
+        typename _Non_Deduced<std::basic_string_view<_Char_Ty>>::type key) noexcept
+    {
+        return (key.size() > 0 && str.size() >= key.size() && str.compare((str.size() - key.size()), key.size(), key) == 0);
+    }
+
+    // Strips whitespace from both ends, unlike TrimStr the whitespace inside str stays.
+    template <typename _Char_Ty>
+    CU_INLINE std::basic_string_view<_Char_Ty> StripStr(std::basic_string_view<_Char_Ty> str) noexcept
+    {
+        static const auto isSpace = [](_Char_Ty ch) -> bool {
+            return (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\b' || ch == '\v' || ch == '\f');
+        };
+        size_t begin = 0;
+        size_t end = str.size();
+        while (begin < end && isSpace(str[begin])) {
+            begin++;
+        }
+        while (end > begin && isSpace(str[end - 1])) {
+            end--;
+        }
+        return str.substr(begin, (end - begin));
+    }
+
     template <typename _Ty>
     CU_INLINE size_t Hash(const _Ty &val)
     {
@@ -880,11 +1227,10 @@ namespace CU
         return -1;
     }
 
+    // Milliseconds on the monotonic Clock, only meaningful as a difference.
     CU_INLINE time_t TimeStamp()
     {
-        auto time_pt = std::chrono::system_clock::now();
-        auto time_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(time_pt);
-	    return static_cast<time_t>(time_ms.time_since_epoch().count());
+        return static_cast<time_t>(Clock::Default()->monotonicMs());
     }
 
     CU_INLINE void SleepMs(time_t time) 
@@ -892,9 +1238,14 @@ namespace CU
         std::this_thread::sleep_for(std::chrono::milliseconds(time));
     }
 
+    CU_INLINE int RunCommand(const char* command) noexcept
+    {
+        return std::system(command);
+    }
+
     CU_INLINE int RunCommand(const std::string &command) noexcept
     {
-        return std::system(command.c_str());
+        return RunCommand(command.c_str());
     }
 
     CU_INLINE void Pause()